@@ -216,6 +216,8 @@ public:
 	FN_DECIMAL GetWhiteNoiseInt(int x, int y, int z, int w) const;
 
 private:
+	template <NoiseType, FractalType, Interp, int> friend class StaticNoise; // staticNoise.hpp reads the tables
+
 	unsigned char m_perm[512];
 	unsigned char m_perm12[512];
 
@@ -0,0 +1,4 @@
+#pragma once
+
+// ./engine --bench <name> runs a headless benchmark instead of opening the game
+int runBenchmark(int argc, char **argv);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "chunk.hpp"
+#include <atomic>
+#include <list>
+#include <mutex>
+
+class Terrain;
+
+#define BIOME_STEP 8 // blocks between two samples of the biome grid
+#define BIOME_REGION 64 // blocks per cached region side, a multiple of the chunk size and BIOME_STEP
+#define BIOME_SAMPLES (BIOME_REGION / BIOME_STEP + 1) // per region side, the last row is also the next region's first
+#define BIOME_CACHE 256 // regions kept, about 81kb
+#define BIOME_DITHER 0.02f // temperature and humidity jitter, biome borders fray instead of following the grid
+
+// temperature and humidity of a BIOME_REGION square, sampled every BIOME_STEP blocks
+struct BiomeRegion
+{
+	float temperature[BIOME_SAMPLES][BIOME_SAMPLES];
+	float humidity[BIOME_SAMPLES][BIOME_SAMPLES];
+};
+
+// surface blocks from temperature and humidity. both noises change over hundreds of blocks,
+// so they're only taken on a coarse grid, cached per region for every chunk in it, and
+// interpolated to the columns in between. shared by the generation threads
+class BiomeEngine
+{
+public:
+	inline BiomeEngine(Terrain *t) : terr(t) {}
+	~BiomeEngine(void);
+	void clear(void); // after the noise changed
+	short getBiome(int x, int z);
+	void fillChunk(int wx, int wz, short *types); // CHUNK_X by CHUNK_Z, x major
+	// nx by nz columns every step blocks from a chunk corner at world wx, wz on, x major.
+	// they stay within the chunk and its far edges, one trip to the cache like fillChunk
+	void fillGrid(int wx, int wz, int step, int nx, int nz, short *types);
+	static short biomeType(float temperature, float humidity);
+	bool coarse = true; // off samples both noises for every column
+	int capacity = BIOME_CACHE;
+	atomic<long> samples{0}; // noise calls, two per grid point or column
+	atomic<long> hits{0};
+	atomic<long> misses{0};
+private:
+	short exact(int x, int z);
+	short blend(float temperature, float humidity, int x, int z);
+	void copyGrid(int x, int z, int nx, int nz, float *temperature, float *humidity);
+	bool copyCached(glm::ivec2 pos, int i0, int j0, int nx, int nz, float *temperature, float *humidity);
+	void sample(glm::ivec2 pos, BiomeRegion &r);
+	void insert(glm::ivec2 pos, const BiomeRegion &sampled);
+	unordered_map<glm::ivec2, pair<BiomeRegion *, list<glm::ivec2>::iterator> > regions;
+	list<glm::ivec2> used; // most recently used first
+	mutex lock;
+	Terrain *terr;
+};
\ No newline at end of file
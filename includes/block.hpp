@@ -6,7 +6,9 @@ public:
 	inline Block() {};
 	inline ~Block() {};
 
-	inline bool isActive(void) { return (!(this->type == Blocktype::AIR_BLOCK || this->type == Blocktype::WATER_BLOCK)); }
+	inline bool isOpaque(void) { return (BLOCKS.flags[this->type] & BLOCK_OPAQUE); }
+	inline bool isSolid(void) { return (BLOCKS.flags[this->type] & BLOCK_SOLID); }
+	inline uint8_t getLight(void) { return (BLOCKS.light[this->type]); }
 	inline uint8_t getType(void) { return this->type; }
 	inline void setType(uint8_t t) { this->type = t; }
 private:
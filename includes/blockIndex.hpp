@@ -35,7 +35,11 @@ enum Blocktype
 	ROOT_BLOCK,
 	LIGHT_BLOCK,
 	SNOW_BLOCK,
-	TREE_LEAF_BLOCK_2
+	TREE_LEAF_BLOCK_2,
+	// cold biome surfaces from Terrain::getBiome, past the end of atlas2's
+	// textures so they show its filler tile
+	TUNDRA_BLOCK = 67, // cold and dry
+	TAIGA_BLOCK = 68 // cold and humid
 };
 
 //atlas3
@@ -101,4 +105,4 @@ enum Blocktype
 // 	FIFTY7,
 // 	FIFTY8,
 // 	FIFTY9,
-// };
\ No newline at end of file
+// };
@@ -0,0 +1,53 @@
+#pragma once
+
+#define ATLAS_TILES 16 // atlas2 is a 16x16 grid of block textures, one texture array layer each
+#define BLOCK_TYPES 256 // every value Block's uint8_t type can hold
+
+// property flags
+#define BLOCK_OPAQUE 1 // hides the faces next to it and stops light
+#define BLOCK_TRANSPARENT 2 // meshed into the blended water pass
+#define BLOCK_SOLID 4 // collides with the player and can be targeted
+#define BLOCK_MESHED (BLOCK_OPAQUE | BLOCK_TRANSPARENT)
+
+// texture array layer of a block face, faces numbered like Chunk::addFace's.
+// layers follow the atlas left to right, top to bottom
+constexpr int blockLayer(int type, int face)
+{
+	int col = (type - 1) % ATLAS_TILES;
+	int row = type / 17;
+	if ((type == GRASS_BLOCK && face != 1) || (type == TREE_BLOCK && (face == 1 || face == 0)))
+		col++;
+	if (type == CACTUS_BLOCK && (face == 1 || face == 0))
+		row++;
+	return (row * ATLAS_TILES + (col & (ATLAS_TILES - 1)));
+}
+
+// per type properties, indexed straight by Block::getType()
+struct BlockRegistry
+{
+	uint8_t flags[BLOCK_TYPES];
+	uint8_t light[BLOCK_TYPES]; // torch light the block emits
+	bool known[BLOCK_TYPES]; // a Blocktype, the other values only fill the tables
+	uint8_t layer[BLOCK_TYPES][6];
+};
+
+constexpr BlockRegistry makeBlockRegistry()
+{
+	BlockRegistry r = {};
+	for (int t = 0; t < BLOCK_TYPES; t++)
+	{
+		if (t == AIR_BLOCK)
+			r.flags[t] = 0;
+		else if (t == WATER_BLOCK)
+			r.flags[t] = BLOCK_TRANSPARENT;
+		else
+			r.flags[t] = BLOCK_OPAQUE | BLOCK_SOLID;
+		r.light[t] = (t == LIGHT_BLOCK) ? 14 : 0;
+		r.known[t] = t <= TREE_LEAF_BLOCK_2 || t == TUNDRA_BLOCK || t == TAIGA_BLOCK;
+		for (int f = 0; f < 6; f++)
+			r.layer[t][f] = blockLayer(t, f);
+	}
+	return (r);
+}
+
+constexpr BlockRegistry BLOCKS = makeBlockRegistry();
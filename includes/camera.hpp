@@ -56,6 +56,7 @@ public:
 
 	inline glm::vec3 GetPosition() { return this->Position; }
 	void SetPosition(glm::vec3 pos) { this->Position = pos; }
+	void SetRotation(float yaw, float pitch) { this->Yaw = yaw; this->Pitch = pitch; updateCameraVectors(); }
 
 	// Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime);
@@ -11,6 +11,23 @@
 #define CHUNK_Y 256
 #define WATER_LEVEL 38
 
+// 3d density around the surface: caves under it, overhangs over it. noise is taken on a
+// lattice of DENSITY_STEP_X/Y/Z blocks and blended to the blocks in between
+#define DENSITY_STEP_X 4
+#define DENSITY_STEP_Y 8
+#define DENSITY_STEP_Z 4 // one sse register of blocks
+#define DENSITY_DEPTH 40 // caves reach this far below the lowest land column of a chunk
+#define DENSITY_HEIGHT 8 // overhangs this far above the highest
+#define DENSITY_SQUASH 8.0f // blocks the surface moves for a noise value of 1
+#define CAVE_LEVEL 0.3f // noise above this is cave
+#define CAVE_CRUST 3 // blocks kept over a cave
+#define CAVE_FLOOR 4 // nothing carved below this
+
+#define CHUNK_POOL_MAX 256 // unloaded chunks kept for reuse, about 128kb each
+
+#define SECTION_Y 16 // 16^3 sections for visibility
+#define SECTIONS (CHUNK_Y / SECTION_Y)
+
 #define SUN_LIGHT_SHIFT 0
 #define SUN_LIGHT_MASK (0xf << SUN_LIGHT_SHIFT)
 #define GET_SUN_LIGHT(v) ((v & SUN_LIGHT_MASK) >> SUN_LIGHT_SHIFT)
@@ -19,6 +36,19 @@
 #define TORCH_LIGHT_MASK (0xf << TORCH_LIGHT_SHIFT)
 #define GET_TORCH_LIGHT(v) ((v & TORCH_LIGHT_MASK) >> TORCH_LIGHT_SHIFT)
 
+// 16 byte block vertex, everything but the position packed into one word:
+// texture layer 0-7, corner u 8 and v 9, face 10-12, torch light 13-16, sun light 17-20
+struct BlockVertex
+{
+	float x, y, z;
+	uint32_t data;
+};
+
+static inline uint32_t packVertex(int layer, glm::vec2 corner, int face, int torch, int sun)
+{
+	return (layer | (int)corner.x << 8 | (int)corner.y << 9 | face << 10 | torch << 13 | sun << 17);
+}
+
 enum ChunkState
 {
 	GENERATE, // needs to be generated completely
@@ -39,17 +69,37 @@ class Chunk
 public:
 	Chunk(int x = 0, int z = 0, Terrain *t = NULL);
 	~Chunk(void);
+	void reset(int x, int z);
 	void update();
-	void render(Shader shader);
-	void renderWater(Shader shader);
+	void mesh();
+	void render(Shader shader, glm::vec3 viewPos, RenderStats &stats);
+	void renderWater(Shader shader, RenderStats &stats);
+	void clearFaces(); // the counts and planes both meshers add to, before either runs
 	void faceRendering();
+	void faceRenderingReference();
 	void buildVAO(void);
-	void addFace(int face, int x, int y, int z, int val, vector<float> *m, int *ps);
+	void addFace(int face, int x, int y, int z, int val, vector<BlockVertex> *m, int *ps);
+	void addOpaqueFace(int face, int x, int y, int z, int val);
+	void buildSectionGraph(void);
+	void buildOccluder(void);
+	void drawOccluder(OcclusionEngine *occlusion);
+	bool isOccluded(OcclusionEngine *occlusion);
+
+	// visibility, faces numbered like addFace's
+	inline bool sectionConnected(int s, int a, int b) { return ((this->sectionGraph[s] >> (a * 6 + b)) & 1); }
+	int sectionVisit[SECTIONS]; // frame a section was last reached by Terrain::findVisible
+	int visibleFrame = -1;
+	inline int getVertexCount() { return (this->pointSize + this->transparentPointSize); }
+	inline const vector<BlockVertex> &getFaceMesh(int face) { return (this->faceMesh[face]); }
+	inline const vector<BlockVertex> &getTransparentMesh() { return (this->transparentMesh); }
 	void cleanVAO(void);
 
 	// state management
 	inline void setState(ChunkState s) { this->state = s; }
 	inline ChunkState getState() { return this->state; }
+	inline void setStage(ChunkStage s) { this->stage = s; }
+	inline ChunkStage getStage() { return this->stage; }
+	int meshCount = 0; // times meshed since generated
 	
 	// neighbors
 	inline void setXMinus(Chunk *chunk) { this->xMinus = chunk; }
@@ -61,8 +111,11 @@ public:
 	inline Chunk *getZMinus() { return (this->zMinus); }
 	inline Chunk *getZPlus() { return (this->zPlus); }
 	vector<blockQueue> neighborQueue;
+	vector<blockQueue> spilled; // handed to a neighbor already, again if that one is unloaded
+	Chunk *spillTarget(glm::ivec3 pos);
+	void forgetNeighbor(Chunk *gone);
 	void neighborQueueUnload();
-	void pullTerrainFromNeighbors();
+	void pullTerrainFromNeighbors(Chunk *around[9]);
 
 	// lighting
 	inline uint8_t getSunLight(int x, int y, int z) {
@@ -83,36 +136,58 @@ public:
 		for (int k = 0; k < CHUNK_Z; k++) {
 			lightMap[i][j][k] |= ~SUN_LIGHT_MASK;
 		}}}}
-	void setTerrain();
+	void setTerrain(bool fullDensity = false); // fullDensity samples every block, for the benchmark
 	int	getBase(int x, int z);
 	int	getWorld(int x, int y, int z);
 	bool neighborsSet = false;
+	bool edited = false; // changed since generated, kept loaded so the edits aren't lost
 	Block *getBlock(int x, int y, int z);
 	void setBlock(glm::ivec3 pos, Blocktype type);
 	inline int getXOff() { return xoff; }
 	inline int getZOff() { return zoff; }
 private:
 	friend class StructureEngine; // now StructureEngine can access private parts of Chunk
+	friend class ChunkPool;
+	void carveDensity(int base[CHUNK_X][CHUNK_Z], short type[CHUNK_X][CHUNK_Z], bool fullDensity);
 	int xoff;
 	int zoff;
 	
 	ChunkState state = GENERATE;
+	ChunkStage stage = NOTHING_DONE;
 
 	Block ***blocks;
 	// TODO: switch these to one map using 4 bits each, sent to buffer as char
 	uint8_t ***lightMap;
+	Block *blockData; // the slabs behind the [x][y][z] tables
+	uint8_t *lightData;
 	glm::mat4 offsetMatrix;
-	unsigned int VAO;
-	unsigned int VBO;
+	// created on the first upload so chunks can be generated without a GL context
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
 
 	int pointSize;
 	int transparentPointSize;
 
-	unsigned int transparentVAO;
-	unsigned int transparentVBO;
+	// only for chunks that have had water to draw
+	unsigned int transparentVAO = 0;
+	unsigned int transparentVBO = 0;
 
-	vector<float> mesh;
-	vector<float> transparentMesh;
+	// opaque faces are bucketed by direction (same order as addFace's face index)
+	// and uploaded as six contiguous ranges so whole directions can be skipped
+	vector<BlockVertex> faceMesh[6];
+	int faceStart[6];
+	int faceCount[6];
+	// world space plane of the face nearest the camera side: the lowest plane for
+	// +y/+x/+z buckets, the highest for -y/-x/-z ones. a bucket can't be seen when
+	// the camera is behind that plane
+	int facePlane[6];
+	// per section bit a * 6 + b is set when faces a and b see each other through it
+	uint64_t sectionGraph[SECTIONS];
+	// height of solid ground under every column of each occluder cell, and the
+	// top of the highest non air block for the chunk's bounding box
+	int occluderTop[OCCLUDER_CELLS * OCCLUDER_CELLS];
+	int maxHeight;
+	vector<BlockVertex> transparentMesh;
 
 	Chunk *xMinus = NULL;
 	Chunk *xPlus = NULL;
@@ -120,4 +195,43 @@ private:
 	Chunk *zPlus = NULL;
 
 	Terrain *terr; // pointer to parent
+};
+
+// chunks unloaded from the world keep their storage and gl buffers for the next
+// position that's loaded instead of going back to the heap and the driver
+class ChunkPool
+{
+public:
+	~ChunkPool(void);
+	Chunk *acquire(int x, int z, Terrain *t);
+	void release(Chunk *c);
+	inline size_t available() { return (this->unused.size()); }
+	size_t limit = CHUNK_POOL_MAX; // released chunks past this are deleted
+	long created = 0;
+	long reused = 0;
+private:
+	vector<Chunk *> unused;
+};
+
+// world space block lookups that remember the last chunk, so a walk through
+// neighboring cells only goes to the chunk map when it crosses into another one
+class BlockAccessor
+{
+public:
+	BlockAccessor(Terrain *t) : terr(t) {}
+	inline Block *getBlock(glm::ivec3 pos)
+	{
+		glm::ivec2 c(floorDiv(pos.x, CHUNK_X), floorDiv(pos.z, CHUNK_Z));
+		if ((!this->chunk || c != this->chunkPos) && !this->setChunk(c))
+			return (NULL);
+		return (this->chunk->getBlock(pos.x - c.x * CHUNK_X, pos.y, pos.z - c.y * CHUNK_Z));
+	}
+	// chunk of the last lookup, NULL when it isn't loaded
+	inline Chunk *getChunk() { return (this->chunk); }
+	inline glm::ivec3 toLocal(glm::ivec3 pos) { return (glm::ivec3(pos.x - this->chunkPos.x * CHUNK_X, pos.y, pos.z - this->chunkPos.y * CHUNK_Z)); }
+private:
+	bool setChunk(glm::ivec2 pos);
+	Terrain *terr;
+	Chunk *chunk = NULL;
+	glm::ivec2 chunkPos;
 };
\ No newline at end of file
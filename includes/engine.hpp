@@ -18,6 +18,9 @@
 #include <glm/gtx/hash.hpp> // for unordered_map
 #include <unordered_map>
 #include <cmath>
+#include <climits>
+#include <cstddef>
+#include <cstring>
 #include <thread>
 #include <string>
 #include <map>
@@ -34,8 +37,12 @@
 #define TEXTURE_SIZE 16
 #define DIST(X,Y,XX,YY) ((YY-Y)/(XX-X));
 #define RENDER_RADIUS 24
+#define UNLOAD_MARGIN 2 // chunks past the render radius kept, so turning back doesn't generate them again
+#define NEAR_PLANE 0.1f // chunks, the player can stand closer than that to a wall
+#define LOD_NEAR_PLANE 1.0f // heightmap tiles, never drawn right in front of the player
 
 #include "blockIndex.hpp" // block types
+#include "blockRegistry.hpp" // block properties
 #include "cubeMap.hpp"
 
 using namespace std; // should move to cpp files for locality?
@@ -47,9 +54,9 @@ void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 unsigned int loadTexture(char const * path);
-unsigned int TextureFromFile(const char *path, const string &directory);
 unsigned int skybox(void);
 unsigned int loadCubemap(vector<std::string> faces);
 float noise(float x, float y);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void diamondSquare(int Array[CHUNK_X][CHUNK_Z], int size);
\ No newline at end of file
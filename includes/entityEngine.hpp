@@ -0,0 +1,25 @@
+#pragma once
+
+#include "physicsEngine.hpp"
+
+#define ENTITIES_PER_THREAD 2048 // fewer than this per worker isn't worth starting a thread
+
+// every entity is an index into parallel arrays, so a tick walks each field
+// front to back. despawning moves the last entity into the freed index
+class EntityEngine
+{
+public:
+	EntityEngine(Terrain *t) : terr(t) {}
+	int spawn(glm::vec3 pos, glm::vec2 size, int model);
+	void despawn(int id);
+	void update(float time, int threads = 0);
+	inline int count() { return ((int)this->pos.size()); }
+
+	vector<glm::vec3> pos; // bottom center of the box
+	vector<glm::vec3> velocity; // blocks per second, y up
+	vector<glm::vec2> size; // half width and height, like PhysicsEngine's bodies
+	vector<int> model; // what to draw it with, -1 for nothing
+private:
+	void updateRange(int begin, int end, float time);
+	Terrain *terr;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "chunk.hpp"
+
+class Terrain;
+struct RenderStats;
+
+#define LOD_TILE 4 // chunks per tile side
+#define LOD_RADIUS (RENDER_RADIUS * 4) // chunks, full detail chunks cover the inner RENDER_RADIUS
+#define LOD_TILES_PER_LOOP 2
+#define LOD_SUN_LIGHT 5
+
+// a LOD_TILE x LOD_TILE chunk patch of heightmap surface sampled every `step` blocks
+// straight from the terrain noise, stored as one mesh segment per chunk so the
+// segments covered by full detail chunks can be left out when drawing
+class LodTile
+{
+public:
+	LodTile(glm::ivec2 pos, int step);
+	~LodTile(void);
+	void build(Terrain *terr, int step);
+	void render(Shader shader, Terrain *terr, glm::ivec2 center, int nearRadius, RenderStats &stats);
+	inline int getStep() { return this->step; }
+private:
+	glm::ivec2 pos; // in tiles
+	int step;
+	glm::mat4 offsetMatrix;
+	unsigned int VAO;
+	unsigned int VBO;
+	int chunkStart[LOD_TILE * LOD_TILE];
+	int chunkCount[LOD_TILE * LOD_TILE];
+};
+
+class LodEngine
+{
+public:
+	inline LodEngine(Terrain *t) : terr(t) {}
+	~LodEngine(void);
+	void update(glm::ivec2 center);
+	void render(Shader shader, glm::ivec2 center, int nearRadius, RenderStats &stats);
+	int radius = LOD_RADIUS; // chunks
+	int ringSize = RENDER_RADIUS; // chunks per detail level, 2x/4x/8x merging
+private:
+	int stepFor(glm::ivec2 tile, glm::ivec2 centerTile);
+	unordered_map<glm::ivec2, LodTile *> tiles;
+	glm::ivec2 centerTile;
+	bool complete = false; // every tile in range is built at the right step
+	Terrain *terr;
+};
@@ -15,15 +15,24 @@ struct Texture {
 class Mesh {
 public:
 	/*  Mesh Data  */
-	vector<Vertex> vertices;
+	vector<Vertex> vertices; // empty for meshes uploaded straight from a cooked model
 	vector<unsigned int> indices;
 	vector<Texture> textures;
 	/*  Functions  */
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
+	Mesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<Texture> &textures);
+	Mesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount, const vector<Texture> &textures);
 	void Draw(Shader shader);
+	void DrawInstanced(Shader shader, int count);
+	void setupInstances(unsigned int instanceVBO);
+	inline unsigned int getIndexCount(void) const { return (this->indexCount); }
 private:
 	/*  Render data  */
-	unsigned int VAO, VBO, EBO;
+	unsigned int VAO = 0, VBO = 0, EBO = 0; // stay 0 for an empty mesh, it draws nothing
+	unsigned int indexCount = 0;
+	// sampler uniform of every texture, looked up again only when the shader changes
+	unsigned int samplerProgram = 0;
+	vector<int> samplerLocations;
 	/*  Functions	*/
-	void setupMesh();
+	void setupMesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount);
+	void bindTextures(Shader &shader);
 };
@@ -2,8 +2,7 @@
 
 #include "shader.hpp"
 #include "mesh.hpp"
-
-unsigned int TextureFromFile(const char *path, const string &directory);
+#include "textureEngine.hpp"
 
 class Model 
 {
@@ -11,13 +10,21 @@ public:
 	// Constructor
 	inline Model(string path) { loadModel(path); }
 	void Draw(Shader shader);
+	void DrawInstanced(Shader shader, const vector<glm::mat4> &transforms);
+	inline const vector<Mesh> &getMeshes(void) const { return (this->meshes); }
+	inline size_t getTextureCount(void) const { return (this->textures_loaded.size()); }
 private:
 	/*  Model Data  */
 	vector<Mesh> meshes;
 	string directory;
 	vector<Texture> textures_loaded; 
+	TextureEngine textureEngine; // holds the preloaded images until the meshes upload them
+	unsigned int instanceVBO = 0; // model matrix per instance, shared by all the meshes
 	/*  Functions   */
 	void loadModel(string path);
+	bool loadCooked(string cooked, string source);
+	void cook(string cooked, string source);
+	Texture loadTexture(string path, string typeName);
 	void processNode(aiNode *node, const aiScene *scene);
 	Mesh processMesh(aiMesh *mesh, const aiScene *scene);
 	vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName);
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "terrain.hpp"
+#include <unordered_set>
+#include <deque>
+
+#define SERVER_PORT 4242
+#define SEND_LIMIT (256 * 1024) // bytes waiting for a client before its chunks and batches are held back
+#define CHUNKS_PER_STREAM 4 // chunks generated for one client per server update, keeps edits responsive
+#define CHUNKS_PER_UPDATE 8 // received chunks meshed per client update, the rest wait for the next frame
+#define MESSAGE_LIMIT (1 << 24) // bigger messages mean a broken or hostile peer
+#define JOURNAL_LENGTH 32 // delta batches kept per chunk, a client further behind gets the whole chunk again
+#define SWEEP_TICKS 64 // server updates between unloading the chunks no client is near anymore
+
+// every message is a uint32_t payload size, a MessageType byte and the payload, in host byte order
+enum MessageType
+{
+	VIEW_MESSAGE = 1, // client: chunk x, z and the radius around it it wants
+	CHUNK_MESSAGE, // server: chunk x, z, the sequence it is at and its palette compressed blocks
+	EDIT_MESSAGE, // client: world x, y, z, block type and an id for the edit
+	DELTA_MESSAGE, // server: chunk x, z, the sequence the batch brings it to and its deltas
+	ACK_MESSAGE, // server: id of the sender's latest edit it handled, applied or refused
+	SEED_MESSAGE // server: the world seed, first thing after connecting
+};
+
+// a delta is 3 bytes: x << 4 | z, y and the new type, local to the chunk
+#define DELTA_SIZE 3
+
+// one tick's edits to a chunk coalesced into a batch, the newest write to a block
+// wins. the last JOURNAL_LENGTH batches stay around for clients catching up
+struct ChunkJournal
+{
+	uint32_t sequence = 0; // batches flushed so far
+	map<uint16_t, uint8_t> pending; // x << 4 | z, y -> type, flushed at the end of the tick
+	map<uint16_t, uint8_t> blocks; // every edit ever made, set again when the chunk is generated anew
+	deque<vector<uint8_t> > history; // newest at the back, it brought the chunk to sequence
+};
+
+// 16 sections of 16x16x16 blocks, each its palette size - 1, the palette and every
+// block's palette index packed into the fewest bits that hold it (none for one type)
+void encodeChunk(Chunk *c, vector<uint8_t> &out);
+bool decodeChunk(const uint8_t *data, size_t size, Chunk *c);
+
+// buffered non blocking socket split into messages
+class Connection
+{
+public:
+	Connection(int fd) : fd(fd) {}
+	~Connection();
+	void send(uint8_t type, const void *payload, uint32_t size);
+	bool flush(); // false once the other end is gone
+	bool receive(); // reads whatever arrived, false once the other end is gone
+	bool next(uint8_t &type, vector<uint8_t> &payload); // pops one complete message
+	inline size_t pending() { return (this->out.size() - this->sent); }
+	inline size_t backlog() { return (this->pending() + this->queued); } // what the peer hasn't taken yet
+	bool valid = true; // cleared by a message over MESSAGE_LIMIT
+	int fd;
+private:
+	vector<uint8_t> in;
+	vector<uint8_t> out;
+	size_t read = 0;
+	size_t sent = 0;
+	size_t queued = 0; // in the kernel's send queue after the last flush, megabytes on a stalled peer
+};
+
+struct ClientState
+{
+	ClientState(int fd) : connection(fd) {}
+	Connection connection;
+	glm::ivec2 center;
+	int radius = 0;
+	vector<glm::ivec2> queue; // chunks still to send, nearest at the back
+	unordered_map<glm::ivec2, uint32_t> sent; // interest set: chunks held and the sequence they are at
+	unordered_set<glm::ivec2> behind; // batches held back while the connection was full
+	uint32_t lastEdit = 0;
+	bool ack = false;
+};
+
+// owns the world: generates what clients look at, streams it nearest first and
+// applies their edits, sending each tick's changes to every client holding the chunk
+class ServerEngine
+{
+public:
+	ServerEngine(Terrain *t, int port = SERVER_PORT); // port 0 picks a free one
+	~ServerEngine();
+	void update(int timeout); // waits up to timeout ms for the sockets, then serves everything ready
+	inline int getPort() { return (this->port); } // 0 when it couldn't listen
+	inline int clientCount() { return (this->clients.size()); }
+	long chunksSent = 0;
+	long chunkBytes = 0;
+	long chunksResent = 0; // to clients too far behind for the journal
+	long batchesSent = 0;
+	long batchBytes = 0;
+	long batchesReplayed = 0; // from the journal to clients catching up
+	long editsApplied = 0;
+	long editsInterested = 0; // applied edits times the clients holding their chunk
+	long chunksUnloaded = 0;
+private:
+	Chunk *prepareChunk(glm::ivec2 pos);
+	void generate(glm::ivec2 pos);
+	void sweep();
+	void handle(ClientState *client, uint8_t type, const vector<uint8_t> &payload);
+	void broadcast();
+	void stream(ClientState *client);
+	void sendChunk(ClientState *client, glm::ivec2 pos);
+	void sendBatch(ClientState *client, glm::ivec2 pos, uint32_t sequence, const vector<uint8_t> &batch);
+	Terrain *terr;
+	int listener = -1;
+	int port = 0;
+	vector<ClientState *> clients;
+	unordered_set<glm::ivec2> complete; // chunks no neighbor can spill structures into anymore
+	unordered_map<glm::ivec2, ChunkJournal> journals; // only chunks edited at least once
+	vector<glm::ivec2> dirty; // journals with pending deltas
+	int ticks = 0;
+};
+
+// the other end, filling a terrain that doesn't generate anything itself. without
+// a terrain chunks are only decoded and counted, the load test's simulated players
+class ClientEngine
+{
+public:
+	ClientEngine(Terrain *t) : terr(t) {}
+	~ClientEngine();
+	bool connect(const string &host, int port = SERVER_PORT);
+	void setView(glm::ivec2 center, int radius);
+	uint32_t sendEdit(glm::ivec3 pos, uint8_t type);
+	bool update(); // false once the server is gone
+	int unloadChunks(glm::ivec2 center, int radius);
+	long chunksReceived = 0;
+	long bytesReceived = 0;
+	long batchesReceived = 0;
+	long batchesDropped = 0; // not the next one for their chunk, always 0 unless the server is broken
+	uint32_t lastEdit = 0; // id of this client's latest edit the server handled
+	bool seeded = false; // the terrain has the server's seed, heightmap tiles match its world
+private:
+	void addChunk(glm::ivec2 pos, uint32_t sequence, const uint8_t *data, size_t size);
+	void applyBatch(glm::ivec2 pos, uint32_t sequence, const uint8_t *data, size_t size);
+	Terrain *terr;
+	unordered_map<glm::ivec2, uint32_t> sequences;
+	unordered_set<glm::ivec2> touched; // remeshed once at the end of the update
+	Connection *connection = NULL;
+	Chunk *scratch = NULL; // decode target without a terrain
+	glm::ivec2 center;
+	int radius = -1;
+	uint32_t nextEdit = 1;
+};
\ No newline at end of file
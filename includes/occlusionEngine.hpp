@@ -0,0 +1,23 @@
+#pragma once
+
+#include "chunk.hpp"
+
+#define OCCLUSION_WIDTH 256 // multiple of 4, rows are filled 4 pixels at a time
+#define OCCLUSION_HEIGHT 128
+#define OCCLUDER_RADIUS 8 // chunks close enough to be drawn as occluders
+#define OCCLUDER_CELLS 2 // occluder boxes per chunk side
+
+// coarse cpu depth buffer: the nearest chunks draw conservative boxes of their
+// solid ground into it, then chunk bounds are tested against it before drawing
+class OcclusionEngine
+{
+public:
+	void clear(glm::mat4 viewProjection);
+	void drawOccluder(glm::vec3 min, glm::vec3 max);
+	bool isVisible(glm::vec3 min, glm::vec3 max);
+private:
+	bool project(glm::vec3 p, glm::vec3 &out);
+	void rasterize(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+	alignas(16) float depth[OCCLUSION_WIDTH * OCCLUSION_HEIGHT];
+	glm::mat4 viewProjection;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "chunk.hpp"
+
+#define PHYSICS_SKIN 0.001f // boxes resting exactly on a cell border don't count as inside the next cell
+#define GRAVITY 26.0f // blocks per second squared
+#define TERMINAL_VELOCITY 60.0f // blocks per second
+#define STEP_HEIGHT 1.0f // ledges walked onto without jumping
+
+// axis aligned boxes against the voxel grid. a body is its bottom center and a
+// size of (half width, height). moves are resolved one axis at a time and every
+// cell layer the leading face passes is tested, so no speed can tunnel through
+// a block. the accessor is per caller, which keeps this safe across threads
+class PhysicsEngine
+{
+public:
+	bool sweep(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, int axis, float d);
+	int move(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, glm::vec3 delta);
+	int walk(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, glm::vec3 delta);
+	bool fall(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, float &velocity, float time);
+	bool isGrounded(BlockAccessor &blocks, glm::vec3 pos, glm::vec2 size);
+	// below the world is solid so nothing falls out of it, unloaded chunks are
+	// walls until they generate
+	inline bool isSolid(BlockAccessor &blocks, glm::ivec3 p)
+	{
+		if (p.y < 0)
+			return (true);
+		if (p.y >= CHUNK_Y)
+			return (false);
+		Block *b = blocks.getBlock(p);
+		return (!b || b->isSolid());
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+// generation stages in the order they run, a chunk records the last one done.
+// ahead of the includes, chunk.hpp needs it
+enum ChunkStage
+{
+	NOTHING_DONE,
+	TERRAIN_DONE, // its own blocks, what its structures spill over waits in neighborQueue
+	STRUCTURES_DONE, // holds what the structures of the 8 chunks around spilled into it
+	LIGHT_DONE,
+	MESH_DONE,
+	UPLOAD_DONE
+};
+
+#include "chunk.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+class Terrain;
+
+#define PIPELINE_JOBS 16 // stages run per frame in the render loop, the same on any core count so chunks arrive in the same frames everywhere
+#define PIPELINE_UPLOADS 4 // meshes uploaded per frame
+#define PIPELINE_WAVE 256 // stages per wave while pregenerating, progress is reported in between
+
+// threads started by the first run that needs them and kept for the next ones
+class WorkerPool
+{
+public:
+	~WorkerPool(void);
+	// work(i) for every i below count on up to threads threads, the caller's included.
+	// returns once all of them are done
+	void run(int count, int threads, const function<void(int)> &work);
+private:
+	void loop(int id);
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable idle;
+	const function<void(int)> *work = NULL;
+	int count = 0;
+	atomic<int> next{0};
+	int active = 0; // workers taking part in the current run
+	int busy = 0; // of those, still working on it
+	int round = 0;
+	bool quit = false;
+};
+
+// generation of a chunk as stages, each one run once the chunk and the neighbors it reads
+// are far enough along, so nothing is ever meshed against a border that changes later:
+//   terrain     its own blocks
+//   structures  what the structures of the 8 chunks around spilled into it, needs their terrain
+//   light       sunlight, stays inside the chunk
+//   mesh        needs the structures of the 4 chunks sharing a face
+//   upload      on the main thread
+// requested chunks pull in the stages they depend on. the stages ready at the start of a
+// wave run side by side on the worker pool, a wave starts and ends inside update so the
+// render, player and entity threads never see a chunk change
+class PipelineEngine
+{
+public:
+	inline PipelineEngine(Terrain *t) : terr(t) {}
+	void request(glm::ivec2 pos); // to be drawn, again every frame it's still wanted
+	bool update(void); // a frame's wave for the requests since the last one, false when there were none
+	void finish(glm::ivec2 pos); // right away, with everything it depends on
+	void pregenerate(glm::ivec2 center, int radius, void (*progress)(int done, int total), int threads);
+	long stages[UPLOAD_DONE + 1] = {0}; // stages run, by the stage they finished
+private:
+	bool wave(int jobs, int uploads, int threads);
+	void need(glm::ivec2 pos, ChunkStage stage);
+	bool ready(glm::ivec2 pos, ChunkStage stage);
+	void link(Chunk *c);
+	void retire(glm::ivec2 pos);
+	vector<glm::ivec2> wanted; // requested since the last wave, nearest first from the render loop
+	unordered_map<glm::ivec2, ChunkStage> needed;
+	vector<glm::ivec2> order; // needed, in the order the requests pulled them in
+	WorkerPool pool;
+	Terrain *terr;
+};
\ No newline at end of file
@@ -4,27 +4,57 @@
 #include "camera.hpp"
 #include "chunk.hpp"
 #include "terrain.hpp"
+#include "physicsEngine.hpp"
+#include "networkEngine.hpp"
+
+// the camera sits at the eye, the collision box hangs below it
+#define PLAYER_EYE 2.5f
+#define PLAYER_HEIGHT 2.7f
+#define PLAYER_HALF_WIDTH 0.3f
+
+// PlayerInput keys and clicks
+#define INPUT_FORWARD 1
+#define INPUT_BACKWARD 2
+#define INPUT_LEFT 4
+#define INPUT_RIGHT 8
+#define INPUT_JUMP 16
+#define CLICK_LEFT 1
+#define CLICK_RIGHT 2
+
+// one frame of input, from glfw or from a replay
+struct PlayerInput
+{
+	uint8_t keys = 0;
+	uint8_t clicks = 0;
+	float yaw = 0.0f; // the camera's after the mouse moved
+	float pitch = 0.0f;
+};
 
 class Player
 {
 public:
-	inline Player(glm::vec3 pos, Terrain *terr) { camera = new Camera(pos); this->terr = terr; }
+	inline Player(glm::vec3 pos, Terrain *terr) : blocks(terr) { camera = new Camera(pos); this->terr = terr; }
 	inline ~Player() { delete camera; }
 	Camera *camera;
 	Chunk *getChunk();
-	void processInput(GLFWwindow *window, float deltaTime);
+	PlayerInput processInput(GLFWwindow *window, float deltaTime); // returns what it applied, for a recording
+	void applyInput(const PlayerInput &input, float deltaTime);
 	inline void setPosition(glm::vec3 pos) { this->camera->SetPosition(pos); }
 	inline glm::vec3 getPosition(void) { return (this->camera->GetPosition()); }
 	inline void update(float time) { this->applyGravity(time); }
 	void applyGravity(float time);
 	bool isGrounded();
 	void jump();
+	int move(glm::vec3 delta, bool walking);
 	void leftMouseClickEvent();
 	void rightMouseClickEvent();
 	int currentBlockPlace = Blocktype::LIGHT_BLOCK;
+	uint8_t clicks = 0; // from the mouse button callback, handled with the next frame's input
+	ClientEngine *client = NULL; // clicks become edits for the server when connected
 private:
 	Terrain *terr;
+	BlockAccessor blocks; // input and gravity move the player one after the other, never at once
 	float health = 1.0f;
-	float velocity = 0.0f;
-	const float gravity = 26.0f;
+	float velocity = 0.0f; // downward
+	const float reach = 32.0f; // blocks, about what the old 50 cell walk covered on a diagonal
 };
\ No newline at end of file
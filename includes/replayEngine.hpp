@@ -0,0 +1,94 @@
+#pragma once
+
+#include "engine.hpp"
+#include "player.hpp"
+#include <chrono>
+
+#define REPLAY_MAGIC 0x314c5052 // "RPL1"
+
+// a replay file is this header and one ReplayRecord per frame, in host byte order
+struct ReplayHeader
+{
+	uint32_t magic;
+	int32_t seed;
+	glm::vec3 start;
+	float yaw;
+	float pitch;
+};
+
+struct ReplayFrame
+{
+	float deltaTime;
+	PlayerInput input;
+	glm::vec3 position; // where the player ended the frame, a replay checks itself against it
+};
+
+// a ReplayFrame as it's stored: plain bytes with the padding spelled out, so a zeroed
+// record writes the same file for the same input on every run
+struct ReplayRecord
+{
+	float deltaTime;
+	uint8_t keys;
+	uint8_t clicks;
+	uint8_t pad[2];
+	float yaw;
+	float pitch;
+	float position[3];
+};
+
+// records the world seed, the start and every frame's input, or plays that back. a replay
+// steps the player with the recorded time steps instead of the clock, so the same
+// log walks the same path through the same world on every build and machine
+class ReplayEngine
+{
+public:
+	~ReplayEngine();
+	bool record(const string &path, int seed, Player *player);
+	bool load(const string &path);
+	void write(float deltaTime, const PlayerInput &input, glm::vec3 position);
+	bool next(ReplayFrame &frame);
+	void check(glm::vec3 position); // after the frame next() returned
+	inline bool isRecording() { return (this->out != NULL); }
+	inline bool done() { return (this->current >= this->frames.size()); }
+	ReplayHeader header;
+	float drift = 0.0f; // farthest the replay got from the recorded path, in blocks
+private:
+	FILE *out = NULL;
+	vector<ReplayFrame> frames;
+	size_t current = 0;
+};
+
+enum FrameStage
+{
+	STAGE_INPUT, // input, network and the player's chunk
+	STAGE_CHUNKS, // sorting, culling and drawing the opaque chunks
+	STAGE_LOD,
+	STAGE_WATER,
+	STAGE_THREADS, // waiting on the player and entity threads
+	STAGE_UPDATES, // chunks generated and meshed
+	STAGE_SWAP, // swap and events, where the wait for the gpu shows up
+	STAGES
+};
+
+// wall time of every frame and of the stages of the render loop it went through
+class FrameTimer
+{
+public:
+	void begin();
+	void stage(FrameStage s); // s just ended
+	void end(); // after the last frame
+	void report();
+	float percentile(float p); // frame time in ms, p from 0 to 1
+	inline size_t frameCount() { return (this->frames.size()); }
+	inline double stageTotal(FrameStage s) { return (this->stages[s]); } // ms
+	double total(); // ms
+	static const char *stageName(int s);
+private:
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point frameStart;
+	Clock::time_point stageStart;
+	double stages[STAGES] = {};
+	vector<float> frames; // ms
+	vector<float> sorted; // frames, for the percentiles
+	bool running = false;
+};
\ No newline at end of file
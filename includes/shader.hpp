@@ -1,11 +1,16 @@
 #pragma once
 
+#include <sys/stat.h>
+
+// linked programs saved by glGetProgramBinary, one file per hash of the sources and driver
+#define SHADER_CACHE "./resources/shaders/cache/"
+
 class Shader
 {
 public:
 	unsigned int ID;
-	// constructor generates the shader on the fly
-	Shader(const char* vertexPath, const char* fragmentPath)
+	// constructor generates the shader on the fly, or loads the program the driver linked last run
+	Shader(const char* vertexPath, const char* fragmentPath, bool cache = true)
 	{
 		// 1. retrieve the vertex/fragment source code from filePath
 		std::string vertexCode;
@@ -35,9 +40,14 @@ public:
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 		}
+		// 2. skip the compiler when this driver already linked the same sources
+		ID = glCreateProgram();
+		std::string binaryPath = cache ? cachePath(vertexCode + '\0' + fragmentCode) : "";
+		if (cache && loadBinary(binaryPath))
+			return ;
 		const char* vShaderCode = vertexCode.c_str();
 		const char * fShaderCode = fragmentCode.c_str();
-		// 2. compile shaders
+		// 3. compile shaders
 		unsigned int vertex, fragment;
 		// vertex shader
 		vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -50,14 +60,19 @@ public:
 		glCompileShader(fragment);
 		checkCompileErrors(fragment, "FRAGMENT");
 		// shader Program
-		ID = glCreateProgram();
 		glAttachShader(ID, vertex);
 		glAttachShader(ID, fragment);
+		if (cache)
+			glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glLinkProgram(ID);
 		checkCompileErrors(ID, "PROGRAM");
 		// delete the shaders as they're linked into our program now and no longer necessary
+		glDetachShader(ID, vertex);
+		glDetachShader(ID, fragment);
 		glDeleteShader(vertex);
 		glDeleteShader(fragment);
+		if (cache)
+			saveBinary(binaryPath);
 	}
 	// activate the shader
 	void use() 
@@ -124,6 +139,59 @@ public:
 	}
 
 private:
+	// cache file for the sources on the current driver, a new driver or edited shader misses
+	std::string cachePath(const std::string &sources)
+	{
+		std::string key = sources;
+		const GLenum strings[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+		for (int i = 0; i < 3; i++)
+		{
+			const char *str = (const char *)glGetString(strings[i]);
+			key += '\0' + std::string(str ? str : "");
+		}
+		uint64_t hash = 14695981039346656037ULL; // fnv-1a
+		for (size_t i = 0; i < key.size(); i++)
+			hash = (hash ^ (unsigned char)key[i]) * 1099511628211ULL;
+		std::stringstream name;
+		name << SHADER_CACHE << std::hex << hash << ".bin";
+		return (name.str());
+	}
+	// format and length, then the binary. false leaves the program unlinked to compile into
+	bool loadBinary(const std::string &path)
+	{
+		std::ifstream file(path.c_str(), std::ios::binary);
+		GLenum format;
+		GLint length, success = 0;
+		if (!file.read((char *)&format, sizeof(format)) || !file.read((char *)&length, sizeof(length)) || length <= 0)
+			return (false);
+		std::vector<char> binary(length);
+		if (!file.read(&binary[0], length))
+			return (false);
+		glProgramBinary(ID, format, &binary[0], length);
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		return (success);
+	}
+	// silently skipped on drivers without binary formats, they compile every run
+	void saveBinary(const std::string &path)
+	{
+		GLint success = 0, length = 0;
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+		glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (!success || length <= 0)
+			return ;
+		std::vector<char> binary(length);
+		GLenum format;
+		glGetProgramBinary(ID, length, &length, &format, &binary[0]);
+		mkdir(SHADER_CACHE, 0755);
+		std::string tmp = path + ".tmp";
+		std::ofstream file(tmp.c_str(), std::ios::binary);
+		file.write((const char *)&format, sizeof(format));
+		file.write((const char *)&length, sizeof(length));
+		file.write(&binary[0], length);
+		file.close();
+		if (!file || rename(tmp.c_str(), path.c_str()) < 0)
+			remove(tmp.c_str());
+	}
 	// utility function for checking shader compilation/linking errors.
 	void checkCompileErrors(unsigned int shader, std::string type)
 	{
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "FastNoise.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+// FastNoise's 2d gradients, GRAD_X and GRAD_Y in FastNoise.cpp
+static const FN_DECIMAL STATIC_GRAD_X[12] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0};
+static const FN_DECIMAL STATIC_GRAD_Y[12] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1};
+
+// FastNoise::GetNoise(x, y) for one configuration fixed at compile time: no switch on the
+// noise, fractal or interpolation type per sample and a loop of Octaves the compiler can
+// unroll. set() copies the permutation tables and settings of a FastNoise configured the
+// same way, after that every sample has the same bits as that FastNoise's.
+// only the 2d perlin noise the terrain uses
+template <FastNoise::NoiseType Type, FastNoise::FractalType Fractal, FastNoise::Interp Interp, int Octaves>
+class StaticNoise
+{
+public:
+	static_assert(Type == FastNoise::Perlin || Type == FastNoise::PerlinFractal, "only perlin noise is specialized");
+	static_assert(Octaves >= 1, "at least one octave");
+
+	StaticNoise(void) {}
+	explicit StaticNoise(const FastNoise &noise) { this->set(noise); }
+
+	void set(const FastNoise &noise)
+	{
+		assert(noise.m_noiseType == Type && noise.m_interp == Interp);
+		assert(Type != FastNoise::PerlinFractal || (noise.m_fractalType == Fractal && noise.m_octaves == Octaves));
+		memcpy(this->perm, noise.m_perm, sizeof(this->perm));
+		memcpy(this->perm12, noise.m_perm12, sizeof(this->perm12));
+		this->frequency = noise.m_frequency;
+		this->lacunarity = noise.m_lacunarity;
+		this->gain = noise.m_gain;
+		this->fractalBounding = noise.m_fractalBounding;
+	}
+
+	inline FN_DECIMAL getNoise(FN_DECIMAL x, FN_DECIMAL y) const
+	{
+		x *= this->frequency;
+		y *= this->frequency;
+		if (Type == FastNoise::Perlin)
+			return (this->single(0, x, y));
+		FN_DECIMAL sum = this->octave(this->perm[0], x, y);
+		FN_DECIMAL amp = 1;
+		for (int i = 1; i < Octaves; i++)
+		{
+			x *= this->lacunarity;
+			y *= this->lacunarity;
+			amp *= this->gain;
+			if (Fractal == FastNoise::RigidMulti)
+				sum -= this->octave(this->perm[i], x, y) * amp;
+			else
+				sum += this->octave(this->perm[i], x, y) * amp;
+		}
+		if (Fractal == FastNoise::RigidMulti)
+			return (sum);
+		return (sum * this->fractalBounding);
+	}
+
+private:
+	unsigned char perm[512];
+	unsigned char perm12[512];
+	FN_DECIMAL frequency = 0;
+	FN_DECIMAL lacunarity = 0;
+	FN_DECIMAL gain = 0;
+	FN_DECIMAL fractalBounding = 0;
+
+	static inline int fastFloor(FN_DECIMAL f) { return (f >= 0 ? (int)f : (int)f - 1); }
+	static inline FN_DECIMAL fastAbs(FN_DECIMAL f) { return (fabs(f)); }
+	static inline FN_DECIMAL lerp(FN_DECIMAL a, FN_DECIMAL b, FN_DECIMAL t) { return (a + t * (b - a)); }
+	static inline FN_DECIMAL interp(FN_DECIMAL t)
+	{
+		if (Interp == FastNoise::Hermite)
+			return (t*t*(3 - 2 * t));
+		if (Interp == FastNoise::Quintic)
+			return (t*t*t*(t*(t * 6 - 15) + 10));
+		return (t);
+	}
+
+	// one octave's sample shaped by the fractal type, as the SinglePerlinFractal* loops do
+	inline FN_DECIMAL octave(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y) const
+	{
+		if (Fractal == FastNoise::Billow)
+			return (fastAbs(this->single(offset, x, y)) * 2 - 1);
+		if (Fractal == FastNoise::RigidMulti)
+			return (1 - fastAbs(this->single(offset, x, y)));
+		return (this->single(offset, x, y));
+	}
+
+	inline FN_DECIMAL grad(unsigned char offset, int x, int y, FN_DECIMAL xd, FN_DECIMAL yd) const
+	{
+		unsigned char lutPos = this->perm12[(x & 0xff) + this->perm[(y & 0xff) + offset]];
+		return (xd*STATIC_GRAD_X[lutPos] + yd*STATIC_GRAD_Y[lutPos]);
+	}
+
+	// FastNoise::SinglePerlin
+	inline FN_DECIMAL single(unsigned char offset, FN_DECIMAL x, FN_DECIMAL y) const
+	{
+		int x0 = fastFloor(x);
+		int y0 = fastFloor(y);
+		int x1 = x0 + 1;
+		int y1 = y0 + 1;
+
+		FN_DECIMAL xs = interp(x - (FN_DECIMAL)x0);
+		FN_DECIMAL ys = interp(y - (FN_DECIMAL)y0);
+
+		FN_DECIMAL xd0 = x - (FN_DECIMAL)x0;
+		FN_DECIMAL yd0 = y - (FN_DECIMAL)y0;
+		FN_DECIMAL xd1 = xd0 - 1;
+		FN_DECIMAL yd1 = yd0 - 1;
+
+		FN_DECIMAL xf0 = lerp(this->grad(offset, x0, y0, xd0, yd0), this->grad(offset, x1, y0, xd1, yd0), xs);
+		FN_DECIMAL xf1 = lerp(this->grad(offset, x0, y1, xd0, yd1), this->grad(offset, x1, y1, xd1, yd1), xs);
+
+		return (lerp(xf0, xf1, ys));
+	}
+};
\ No newline at end of file
@@ -2,33 +2,135 @@
 
 #include "chunk.hpp"
 #include "FastNoise.hpp"
+#include "staticNoise.hpp"
 #include "lightEngine.hpp"
 #include "structureEngine.hpp"
+#include "lodEngine.hpp"
+#include "occlusionEngine.hpp"
+#include "biomeEngine.hpp"
+#include "pipelineEngine.hpp"
 
 class Player;
+class PhysicsEngine; // physicsEngine.hpp, needs BlockAccessor
+class EntityEngine;
+class BlockAccessor; // chunk.hpp, needs the whole Chunk
+class ChunkPool;
 
 float noise(float x, float y);
 
+// floor(a / b) for negative world coordinates too
+static inline int floorDiv(int a, int b) { return ((a >= 0) ? a / b : (a - b + 1) / b); }
+
+// per frame counters filled in while drawing chunks
+struct RenderStats
+{
+	int drawCalls = 0;
+	int chunks = 0;
+	long vertices = 0;
+	long facesSkipped = 0; // faces in direction buckets facing away from the camera
+	int chunksCulled = 0; // chunks in the radius the section graph found no way to see
+	int chunksOccluded = 0; // chunks of those hidden behind nearer ground in the occlusion buffer
+};
+
+// setNoise's layers with their settings as template parameters, sampled per column
+typedef StaticNoise<FastNoise::PerlinFractal, FastNoise::FBM, FastNoise::Quintic, 1> HillNoise1;
+typedef StaticNoise<FastNoise::PerlinFractal, FastNoise::FBM, FastNoise::Quintic, 2> HillNoise2;
+typedef StaticNoise<FastNoise::PerlinFractal, FastNoise::FBM, FastNoise::Quintic, 3> HillNoise3;
+typedef StaticNoise<FastNoise::PerlinFractal, FastNoise::FBM, FastNoise::Quintic, 3> TemperatureNoise;
+typedef StaticNoise<FastNoise::Perlin, FastNoise::FBM, FastNoise::Quintic, 1> HumidityNoise;
+
+struct SectionNode
+{
+	SectionNode(Chunk *c, int s, int i, int d) : chunk(c), section(s), in(i), dirs(d) {}
+	Chunk *chunk;
+	int section;
+	int in; // face it was entered through, -1 for the camera's section
+	int dirs; // directions stepped so far, never stepped back against
+};
+
+// first solid block along a ray, cells in world block coordinates
+struct RaycastHit
+{
+	bool hit = false;
+	glm::ivec3 pos; // the solid block
+	glm::ivec3 previous; // the cell before it, where a placed block goes. pos when the ray starts inside a block
+	glm::ivec3 normal; // of the face the ray entered through, zero when it started inside
+	float distance = 0.0f;
+	Block *block = NULL;
+	Chunk *chunk = NULL; // holding pos
+};
+
 class Terrain
 {
 public:
-	Terrain(void);
+	Terrain(void); // seeded from the clock
+	Terrain(int seed);
 	~Terrain(void);
 	inline Chunk *getChunk(glm::ivec2 pos) { if (this->world.find(pos) != this->world.end()) return (this->world[pos]); return NULL; }
 	void updateChunk(glm::ivec2 pos);
-	bool renderChunk(glm::ivec2 pos, Shader shader);
+	Chunk *addChunk(glm::ivec2 pos); // blank, from the pool
+	void unloadChunk(glm::ivec2 pos);
+	int unloadChunks(glm::ivec2 center, int radius, bool keepEdited = true);
+	void pregenerate(glm::ivec2 center, int radius, void (*progress)(int done, int total) = NULL, int threads = 0);
+	Chunk *requestChunk(glm::ivec2 pos);
+	bool renderChunk(glm::ivec2 pos, Shader shader, glm::vec3 viewPos);
 	bool renderWaterChunk(glm::ivec2 pos, Shader shader);
 	void setNoise(void);
+	inline int getSeed() { return (this->seed); }
+	inline void setSeed(int seed) { this->seed = seed; this->setNoise(); } // before any chunk is generated
+	int getBase(int x, int z);
+	short getBiome(int x, int z);
 	void setNeighbors(glm::ivec2 pos);
+	void sortRenderOrder(glm::ivec2 center, int radius);
+	bool findVisible(glm::vec3 viewPos, glm::ivec2 center, int radius);
+	bool cullChunks(glm::vec3 viewPos, glm::mat4 viewProjection, glm::ivec2 center, int radius);
+	bool isCulled(glm::ivec2 pos);
+	RaycastHit raycast(glm::vec3 origin, glm::vec3 dir, float maxDist);
+	RaycastHit raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, BlockAccessor &blocks);
+	void raycastBatch(const vector<glm::vec3> &origins, const vector<glm::vec3> &dirs, float maxDist, vector<RaycastHit> &hits);
+	void updateBlock(glm::ivec3 pos);
+	bool setBlock(glm::ivec3 pos, int type, bool remesh = true);
 	unordered_map<glm::ivec2, Chunk *> world;
 	stack<glm::ivec2> updateList;
+	vector<glm::ivec2> renderOrder; // chunks around the player, nearest first
+	RenderStats stats; // reset by the render loop every frame
+	bool caveCulling = true; // walk the section graph instead of drawing the whole radius
+	bool occlusionCulling = true; // test chunk bounds against a cpu depth buffer of nearby ground
+	bool generate = true; // off on a client, chunks only come from the server
+	bool staged = true; // generated in stages by pipelineEngine, off: a chunk at a time in updateChunk
+	ChunkPool *chunkPool;
 	LightEngine *lightEngine;
+	LodEngine *lodEngine;
+	OcclusionEngine *occlusionEngine;
+	BiomeEngine *biomeEngine;
+	PipelineEngine *pipelineEngine;
+	PhysicsEngine *physicsEngine;
+	EntityEngine *entityEngine;
+	// setNoise's configurations, the reference the layers below are checked against (--bench noise)
+	inline const FastNoise *getTemperatureNoise() const { return (this->temperatureNoise); }
+	inline const FastNoise *getHumidityNoise() const { return (this->humidityNoise); }
+	inline const FastNoise *getTerrainNoise1() const { return (this->terrainNoise1); }
+	inline const FastNoise *getTerrainNoise2() const { return (this->terrainNoise2); }
+	inline const FastNoise *getTerrainNoise3() const { return (this->terrainNoise3); }
+	// static copies of those, sampled by generation
+	TemperatureNoise temperatureLayer;
+	HumidityNoise humidityLayer;
+	HillNoise1 terrainLayer1;
+	HillNoise2 terrainLayer2;
+	HillNoise3 terrainLayer3;
 private:
 	friend class Chunk;
+	// configured by setNoise
 	FastNoise *temperatureNoise;
 	FastNoise *humidityNoise;
 	FastNoise *terrainNoise1;
 	FastNoise *terrainNoise2;
 	FastNoise *terrainNoise3;
+	FastNoise *densityNoise; // 3d, on the lattice of Chunk::carveDensity
 	StructureEngine *structureEngine;
+	int seed;
+	glm::ivec2 renderCenter;
+	int renderRadius = 0;
+	int frame = 0;
+	vector<SectionNode> sectionQueue;
 };
\ No newline at end of file
@@ -1,10 +1,38 @@
 #pragma once
 
+// a decoded image with its mip chain, level after level and layer after layer
+// within a level. mapped from the cooked file next to the source or decoded now
+struct TextureImage
+{
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	int layers = 1; // tiles * tiles for an atlas split into a texture array
+	int levels = 0; // 1 when the driver still has to build the mipmaps
+	const unsigned char *pixels = NULL;
+	void *map = NULL;
+	size_t mapSize = 0;
+	vector<unsigned char> data; // owns pixels when nothing is mapped
+};
+
 class TextureEngine
 {
 public:
 	inline TextureEngine() {};
+	~TextureEngine();
+	// owns the preloaded images, a copy would free them twice
+	TextureEngine(const TextureEngine &) = delete;
+	TextureEngine &operator=(const TextureEngine &) = delete;
+	void preload(const vector<string> &paths, int tiles = 0, bool mipmaps = true); // cubemap faces go without
 	unsigned int loadTexture(char const *path);
+	unsigned int loadTextureArray(char const *path, int tiles);
 	unsigned int loadCubemap(vector<std::string> faces);
 	unsigned int TextureFromFile(const char *path, const string &directory);
+	bool cache = true; // cook decoded images next to their source and map them on later runs
+private:
+	unordered_map<string, TextureImage *> images; // preloaded, waiting for their upload
+	TextureImage *decode(const string &path, int tiles, bool mipmaps);
+	TextureImage *take(const string &path, int tiles, bool mipmaps = true);
+	void upload(GLenum target, TextureImage *image, bool mipmaps);
+	void release(TextureImage *image);
 };
\ No newline at end of file
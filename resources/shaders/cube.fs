@@ -1,14 +1,14 @@
 #version 330 core
 out vec4 FragColor;
 
-in vec2 TexCoord;
-in vec3 Norm;
+in vec3 TexCoord; // corner uv and texture array layer
+in float Shade;
 in float TorchLight;
 in float SunLight;
 in float Visibility;
 
 // texture sampler
-uniform sampler2D atlas;
+uniform sampler2DArray atlas;
 uniform float transparency;
 // uniform vec3 skyColor;
 // const vec3 skyColor(0.8f,0.8f,0.9f);
@@ -33,18 +33,9 @@ void main()
 	FragColor.z += SunLight/16;
 
 
-	if (Norm.y == -1.0f)
-	{
-		FragColor.x += 0.2f;
-		FragColor.y += 0.2f;
-		FragColor.z += 0.2f;
-	}
-	if (Norm.y == 1.0f)
-	{
-		FragColor.x -= 0.4f;
-		FragColor.y -= 0.4f;
-		FragColor.z -= 0.4f;
-	}
+	FragColor.x += Shade;
+	FragColor.y += Shade;
+	FragColor.z += Shade;
 
 	// FragColor = mix(vec4(skyColor,1.0 ),FragColor,Visibility);
 
@@ -1,16 +1,13 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in vec3 aNorm;
-layout (location = 3) in float aTorchLight;
-layout (location = 4) in float aSunLight;
+layout (location = 1) in uint aData; // packed by packVertex in chunk.hpp
 
 uniform mat4 transform;
 uniform mat4 projection;
 uniform mat4 view;
 
-out vec2 TexCoord;
-out vec3 Norm;
+out vec3 TexCoord;
+out float Shade;
 out float TorchLight;
 out float SunLight;
 // out float Visibility;
@@ -18,12 +15,15 @@ out float SunLight;
 // const float density = 0.007f;
 // const float gradient = 1.5f;
 
+// brightness offset per face (down, up, xpos, zpos, xneg, zneg)
+const float shade[6] = float[6](-0.4f, 0.2f, 0.0f, 0.0f, 0.2f, 0.0f);
+
 void main()
 {
-	SunLight = aSunLight;
-	TorchLight = aTorchLight;
-	TexCoord = aTexCoord;
-	Norm = aNorm;
+	SunLight = float((aData >> 17u) & 15u);
+	TorchLight = float((aData >> 13u) & 15u);
+	TexCoord = vec3(float((aData >> 8u) & 1u), float((aData >> 9u) & 1u), float(aData & 255u));
+	Shade = shade[(aData >> 10u) & 7u];
 
 	// vec4 positionRelativeToCam = view * transform;
 	gl_Position = projection * view * transform * vec4(aPos, 1.0f);
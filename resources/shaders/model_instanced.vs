@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aModel; // per instance, locations 3 to 6
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+	FragPos = vec3(aModel * vec4(aPos, 1.0));
+	Normal = mat3(transpose(inverse(aModel))) * aNormal;
+	TexCoords = aTexCoords;
+	
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
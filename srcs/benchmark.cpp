@@ -0,0 +1,1460 @@
+#include <engine.hpp>
+#include <terrain.hpp>
+#include <chunk.hpp>
+#include <benchmark.hpp>
+#include <physicsEngine.hpp>
+#include <entityEngine.hpp>
+#include <model.hpp>
+#include <textureEngine.hpp>
+#include <player.hpp>
+#include <networkEngine.hpp>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <tuple>
+#include <random>
+#include <unistd.h>
+#include <dirent.h>
+
+#define BENCH_SEED 1337 // the same world on every run and build
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// every operator new in the process, for the allocation counts of benchPool. only built with
+// -D BENCH_ALLOCATIONS (see the Makefile), it would cost every allocation of the engine and
+// server an atomic increment
+static atomic<long> allocations(0);
+
+#ifdef BENCH_ALLOCATIONS
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, memory_order_relaxed);
+	if (void *p = malloc(size ? size : 1))
+		return (p);
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+#endif
+
+// an allocation count for the bench output, or a note that the build doesn't count them
+static string allocationCount(long count, int per)
+{
+#ifdef BENCH_ALLOCATIONS
+	return (to_string(count) + " allocations (" + to_string(count / per) + " per chunk)");
+#else
+	(void)count;
+	(void)per;
+	return ("allocations not counted (build with -D BENCH_ALLOCATIONS)");
+#endif
+}
+
+static double msSince(Clock::time_point start)
+{
+	return (std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+}
+
+// generates and meshes a square of chunks around the origin without a GL context
+static void generateArea(Terrain *t, int radius)
+{
+	for (int i = -radius; i <= radius; i++)
+		for (int j = -radius; j <= radius; j++)
+			t->updateChunk(glm::ivec2(i, j));
+	for (int i = -radius; i <= radius; i++)
+		for (int j = -radius; j <= radius; j++)
+			t->setNeighbors(glm::ivec2(i, j));
+}
+
+// cull time and rejected chunks for the section graph alone and with the occlusion pass,
+// looking around from the surface of a generated area
+static int benchOcclusion(void)
+{
+	const int radius = 16;
+	const int frames = 50;
+	Terrain *t = new Terrain(BENCH_SEED);
+	Clock::time_point start = Clock::now();
+	generateArea(t, radius + 1);
+	cout << "generated " << t->world.size() << " chunks in " << msSince(start) << " ms" << endl;
+
+	glm::vec3 eye(CHUNK_X / 2.0f, t->getBase(CHUNK_X / 2, CHUNK_Z / 2) + 2.5f, CHUNK_Z / 2.0f);
+	// the render loop's chunk pass projection, for this radius
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, NEAR_PLANE, radius * CHUNK_X * 1.5f);
+	t->sortRenderOrder(glm::ivec2(0, 0), radius);
+	for (int mode = 0; mode < 2; mode++)
+	{
+		t->occlusionCulling = mode;
+		double ms = 0.0;
+		long culled = 0;
+		long tested = 0;
+		for (int f = 0; f < frames; f++)
+		{
+			float yaw = glm::radians(360.0f * f / frames);
+			glm::vec3 front(cos(yaw), -0.1f, sin(yaw));
+			glm::mat4 view = glm::lookAt(eye, eye + front, glm::vec3(0.0f, 1.0f, 0.0f));
+			t->stats = RenderStats();
+			start = Clock::now();
+			t->cullChunks(eye, projection * view, glm::ivec2(0, 0), radius);
+			ms += msSince(start);
+			for (size_t i = 0; i < t->renderOrder.size(); i++)
+				culled += t->isCulled(t->renderOrder[i]);
+			tested += t->renderOrder.size();
+		}
+		cout << (mode ? "section graph + occlusion: " : "section graph: ") << ms / frames << " ms per frame, "
+			<< 100.0 * culled / tested << "% of " << t->renderOrder.size() << " chunks rejected" << endl;
+	}
+	delete t;
+	return (0);
+}
+
+typedef std::tuple<int, float, float, float, uint32_t> FaceKey;
+
+// every face of the chunk's current mesh as (bucket, first vertex), sorted
+static vector<FaceKey> faceSet(Chunk *c)
+{
+	vector<FaceKey> faces;
+	for (int b = 0; b < 7; b++)
+	{
+		const vector<BlockVertex> &m = (b < 6) ? c->getFaceMesh(b) : c->getTransparentMesh();
+		for (size_t i = 0; i < m.size(); i += 6)
+			faces.push_back(FaceKey(b, m[i].x, m[i].y, m[i].z, m[i].data));
+	}
+	std::sort(faces.begin(), faces.end());
+	return (faces);
+}
+
+// the per block reference mesher against the column bitmask one on the same
+// chunks: best of several rounds each, and both have to find the same faces
+static int benchMesh(void)
+{
+	const int radius = 6;
+	const int rounds = 10;
+	Terrain *t = new Terrain(BENCH_SEED);
+	generateArea(t, radius + 1);
+	double best[2] = {0.0, 0.0};
+	long vertices = 0;
+	int chunks = (radius * 2 + 1) * (radius * 2 + 1);
+	for (int r = 0; r < rounds; r++)
+	{
+		double ms[2] = {0.0, 0.0};
+		for (int i = -radius; i <= radius; i++)
+		{
+			for (int j = -radius; j <= radius; j++)
+			{
+				Chunk *c = t->getChunk(glm::ivec2(i, j));
+				vector<FaceKey> faces[2];
+				int counts[2] = {0, 0};
+				for (int m = 0; m < 2; m++)
+				{
+					c->clearFaces(); // like mesh() does, or every pass adds to the last one's counts
+					Clock::time_point start = Clock::now();
+					if (m == 0)
+						c->faceRenderingReference();
+					else
+						c->faceRendering();
+					ms[m] += msSince(start);
+					if (!r)
+					{
+						faces[m] = faceSet(c);
+						counts[m] = c->getVertexCount();
+					}
+					c->buildVAO(); // drops the mesh again
+				}
+				vertices += (long)faces[1].size() * 6;
+				if (!r && (faces[0] != faces[1] || counts[0] != counts[1] || counts[1] != (int)faces[1].size() * 6))
+				{
+					cout << "chunk " << i << " " << j << ": " << faces[0].size() << " reference faces, "
+						<< faces[1].size() << " bitmask faces, " << counts[0] << " and " << counts[1] << " vertices counted" << endl;
+					return (1);
+				}
+			}
+		}
+		for (int m = 0; m < 2; m++)
+			if (!r || ms[m] < best[m])
+				best[m] = ms[m];
+	}
+	cout << "reference: " << best[0] / chunks << " ms per chunk, bitmask: " << best[1] / chunks << " ms per chunk ("
+		<< best[0] / best[1] << "x), identical faces" << endl;
+	cout << vertices / chunks << " vertices of " << sizeof(BlockVertex) << " bytes ("
+		<< vertices / chunks * sizeof(BlockVertex) / 1024 << " KiB per chunk)" << endl;
+	delete t;
+	return (0);
+}
+
+// the neighbor face test faceRendering runs per block side, as the old compare
+// chain against AIR/WATER and as registry lookups, over real generated blocks
+static int benchRegistry(void)
+{
+	const int rounds = 20;
+	Terrain *t = new Terrain(BENCH_SEED);
+	generateArea(t, 2);
+	vector<uint8_t> types;
+	for (auto it = t->world.begin(); it != t->world.end(); it++)
+		for (int x = 0; x < CHUNK_X; x++)
+			for (int y = 0; y < CHUNK_Y; y++)
+				for (int z = 0; z < CHUNK_Z; z++)
+					types.push_back(it->second->getBlock(x, y, z)->getType());
+
+	long chain = 0;
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+	{
+		for (size_t i = 1; i < types.size(); i++)
+		{
+			int type = types[i];
+			int n = types[i - 1];
+			if (type == AIR_BLOCK)
+				continue ;
+			if (type == WATER_BLOCK)
+				chain += (n == AIR_BLOCK || (n == WATER_BLOCK && type != WATER_BLOCK));
+			else
+				chain += (n == AIR_BLOCK || n == WATER_BLOCK);
+		}
+	}
+	double chainMs = msSince(start);
+
+	long table = 0;
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+	{
+		for (size_t i = 1; i < types.size(); i++)
+		{
+			int type = types[i];
+			int n = types[i - 1];
+			if (!(BLOCKS.flags[type] & BLOCK_MESHED))
+				continue ;
+			table += !(BLOCKS.flags[n] & BLOCK_OPAQUE) & (n != type);
+		}
+	}
+	double tableMs = msSince(start);
+
+	double checks = (double)rounds * (types.size() - 1);
+	cout << "compare chain: " << chainMs * 1e6 / checks << " ns per check, registry: " << tableMs * 1e6 / checks
+		<< " ns per check (" << table / rounds << " faces)" << endl;
+	delete t;
+	if (chain != table)
+	{
+		cout << "face counts differ: " << chain << " vs " << table << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// rays in random directions from random spots above the ground of a generated
+// area, one accessor per ray against the shared batch one. every hit has to be
+// a solid block entered from the empty cell next to it
+static int benchRaycast(void)
+{
+	const int radius = 4;
+	const int count = 200000;
+	const float maxDist = 64.0f;
+	Terrain *t = new Terrain(BENCH_SEED);
+	generateArea(t, radius);
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	vector<glm::vec3> origins(count), dirs(count);
+	for (int i = 0; i < count; i++)
+	{
+		float x = unit(rng) * radius * CHUNK_X;
+		float z = unit(rng) * radius * CHUNK_Z;
+		origins[i] = glm::vec3(x, t->getBase(floor(x), floor(z)) + 2.5f + (unit(rng) + 1.0f) * 8.0f, z);
+		do
+			dirs[i] = glm::vec3(unit(rng), unit(rng), unit(rng));
+		while (glm::length(dirs[i]) < 0.01f);
+	}
+
+	vector<RaycastHit> single(count), batch;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < count; i++)
+		single[i] = t->raycast(origins[i], dirs[i], maxDist);
+	double singleMs = msSince(start);
+	start = Clock::now();
+	t->raycastBatch(origins, dirs, maxDist, batch);
+	double batchMs = msSince(start);
+
+	int hits = 0;
+	double dist = 0.0;
+	BlockAccessor blocks(t);
+	for (int i = 0; i < count; i++)
+	{
+		const RaycastHit &h = single[i];
+		if (h.hit != batch[i].hit || (h.hit && (h.pos != batch[i].pos || h.previous != batch[i].previous)))
+		{
+			cout << "ray " << i << ": single and batch casts disagree" << endl;
+			return (1);
+		}
+		if (!h.hit)
+			continue ;
+		Block *prev = blocks.getBlock(h.previous);
+		if (!h.block->isSolid() || h.previous != h.pos + h.normal
+			|| (h.previous != h.pos && prev && prev->isSolid()))
+		{
+			cout << "ray " << i << ": bad hit at " << h.pos.x << " " << h.pos.y << " " << h.pos.z << endl;
+			return (1);
+		}
+		hits++;
+		dist += h.distance;
+	}
+	cout << "single: " << count / singleMs * 1000.0 << " rays/s, batch: " << count / batchMs * 1000.0
+		<< " rays/s, " << 100.0 * hits / count << "% hit at " << dist / max(hits, 1) << " blocks on average" << endl;
+	delete t;
+	return (0);
+}
+
+// top of the highest solid cell under a box's footprint, scanned the slow way
+static float landingHeight(BlockAccessor &blocks, glm::vec3 pos, glm::vec2 size)
+{
+	int top = 0;
+	for (int x = floor(pos.x - size.x + PHYSICS_SKIN); x <= floor(pos.x + size.x - PHYSICS_SKIN); x++)
+		for (int z = floor(pos.z - size.x + PHYSICS_SKIN); z <= floor(pos.z + size.x - PHYSICS_SKIN); z++)
+			for (int y = floor(pos.y) - 1; y >= top; y--)
+				if (blocks.getBlock(glm::ivec3(x, y, z))->isSolid())
+				{
+					top = y + 1;
+					break ;
+				}
+	return ((float)top);
+}
+
+// random walking and falling bodies over a generated area, then bodies dropped
+// at terminal velocity with frame times up to half a second, which all have to
+// land exactly on the highest block under them
+static int benchPhysics(void)
+{
+	const int radius = 3;
+	const int bodies = 2000;
+	const int ticks = 100;
+	const glm::vec2 size(0.3f, 2.7f);
+	Terrain *t = new Terrain(BENCH_SEED);
+	generateArea(t, radius);
+	PhysicsEngine *physics = t->physicsEngine;
+	BlockAccessor blocks(t);
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	float extent = radius * CHUNK_X - 1.0f;
+	vector<glm::vec3> pos(bodies);
+	vector<float> velocity(bodies, 0.0f);
+	for (int i = 0; i < bodies; i++)
+	{
+		float x = unit(rng) * extent, z = unit(rng) * extent;
+		pos[i] = glm::vec3(x, landingHeight(blocks, glm::vec3(x, CHUNK_Y, z), size) + (unit(rng) + 1.0f) * 4.0f, z);
+	}
+	long queries = 0;
+	Clock::time_point start = Clock::now();
+	for (int k = 0; k < ticks; k++)
+	{
+		for (int i = 0; i < bodies; i++)
+		{
+			// 1/60 s of walking at the player's speed
+			glm::vec3 delta(unit(rng) * 0.25f, 0.0f, unit(rng) * 0.25f);
+			delta = glm::clamp(delta, glm::vec3(-extent) - pos[i], glm::vec3(extent) - pos[i]);
+			physics->walk(blocks, pos[i], size, delta);
+			physics->fall(blocks, pos[i], size, velocity[i], 1.0f / 60.0f);
+			queries += 2;
+		}
+	}
+	double ms = msSince(start);
+	cout << queries / ms * 1000.0 << " walk and fall queries/s (" << ms * 1000.0 / queries << " us each)" << endl;
+
+	const float frames[] = {1.0f / 60.0f, 0.1f, 0.5f};
+	for (int f = 0; f < 3; f++)
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			glm::vec3 p(unit(rng) * extent, CHUNK_Y - 8.0f, unit(rng) * extent);
+			float expected = landingHeight(blocks, p, size);
+			float v = TERMINAL_VELOCITY;
+			int steps = 0;
+			while (!physics->fall(blocks, p, size, v, frames[f]) && steps++ < 10000)
+				v = TERMINAL_VELOCITY;
+			if (p.y != expected)
+			{
+				cout << "body at " << p.x << " " << p.z << " falling " << TERMINAL_VELOCITY * frames[f]
+					<< " blocks per step stopped at " << p.y << ", the ground is at " << expected << endl;
+				return (1);
+			}
+		}
+	}
+	cout << "3000 drops at terminal velocity (" << TERMINAL_VELOCITY << " blocks/s, up to "
+		<< TERMINAL_VELOCITY * frames[2] << " blocks per step) all landed on the ground" << endl;
+	delete t;
+	return (0);
+}
+
+// 10k wandering entities spread over a generated area, ticked at 60 Hz on one
+// thread and on every core. none may end up inside a block
+static int benchEntities(void)
+{
+	const int radius = 4;
+	const int entities = 10000;
+	const int ticks = 200;
+	Terrain *t = new Terrain(BENCH_SEED);
+	generateArea(t, radius);
+	EntityEngine *e = t->entityEngine;
+	BlockAccessor blocks(t);
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	float extent = radius * CHUNK_X - 1.0f;
+	for (int i = 0; i < entities; i++)
+	{
+		glm::vec3 p(unit(rng) * extent, CHUNK_Y, unit(rng) * extent);
+		p.y = landingHeight(blocks, p, glm::vec2(0.3f, 1.8f));
+		int id = e->spawn(p, glm::vec2(0.3f, 1.8f), -1);
+		e->velocity[id] = glm::vec3(unit(rng) * 4.0f, 0.0f, unit(rng) * 4.0f);
+	}
+	int cores = max(1, (int)thread::hardware_concurrency());
+	for (int pass = 0; pass < 2; pass++)
+	{
+		int threads = pass ? cores : 1;
+		Clock::time_point start = Clock::now();
+		for (int k = 0; k < ticks; k++)
+			e->update(1.0f / 60.0f, threads);
+		cout << threads << (threads > 1 ? " threads: " : " thread: ") << msSince(start) / ticks << " ms per tick of "
+			<< entities << " entities" << endl;
+	}
+	for (int i = 0; i < e->count(); i++)
+	{
+		glm::vec3 p = e->pos[i];
+		glm::vec2 s = e->size[i];
+		for (int x = floor(p.x - s.x + PHYSICS_SKIN); x <= floor(p.x + s.x - PHYSICS_SKIN); x++)
+			for (int y = floor(p.y + PHYSICS_SKIN); y <= floor(p.y + s.y - PHYSICS_SKIN); y++)
+				for (int z = floor(p.z - s.x + PHYSICS_SKIN); z <= floor(p.z + s.x - PHYSICS_SKIN); z++)
+					if (t->physicsEngine->isSolid(blocks, glm::ivec3(x, y, z)))
+					{
+						cout << "entity " << i << " ended up inside the block at " << x << " " << y << " " << z << endl;
+						return (1);
+					}
+	}
+	delete t;
+	return (0);
+}
+
+// hidden window for the benchmarks that need a GL context, NULL when there's no display
+static GLFWwindow *createHiddenWindow(void)
+{
+	if (!glfwInit())
+		return (NULL);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "benchmark", NULL, NULL);
+	if (!window)
+	{
+		glfwTerminate();
+		return (NULL);
+	}
+	glfwMakeContextCurrent(window);
+	glEnable(GL_DEPTH_TEST);
+	return (window);
+}
+
+// cpu time to submit 1000 nanosuits a frame, one Model::Draw per copy against
+// a single Model::DrawInstanced, and the time until the gpu is done with them.
+// both have to draw the same picture, pixel for pixel
+static int benchModels(void)
+{
+	const int instances = 1000;
+	const int frames = 10;
+	GLFWwindow *window = createHiddenWindow();
+	if (!window)
+	{
+		cout << "no GL context, skipped" << endl;
+		return (0);
+	}
+	Clock::time_point start = Clock::now();
+	Model *nanosuit = new Model("./resources/models/nanosuit/nanosuit.obj");
+	cout << "nanosuit loaded in " << msSince(start) << " ms" << endl;
+	Shader single("./resources/shaders/model_shader.vs", "./resources/shaders/model_shader.fs");
+	Shader instanced("./resources/shaders/model_instanced.vs", "./resources/shaders/model_shader.fs");
+
+	vector<glm::mat4> transforms;
+	for (int i = 0; i < instances; i++)
+	{
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3((i % 40) * 2.0f - 40.0f, -2.0f, (i / 40) * -2.0f - 5.0f));
+		transforms.push_back(glm::scale(m, glm::vec3(0.1f)));
+	}
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 200.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 4.0f, 5.0f), glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Shader *shaders[2] = {&single, &instanced};
+	vector<unsigned char> pixels[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		Shader &shader = *shaders[mode];
+		shader.use();
+		shader.setMat4("projection", projection);
+		shader.setMat4("view", view);
+		shader.setVec3("viewPos", glm::vec3(0.0f, 4.0f, 5.0f));
+		shader.setVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
+		shader.setVec3("dirLight.ambient", glm::vec3(0.3f));
+		shader.setVec3("dirLight.diffuse", glm::vec3(0.6f));
+		shader.setVec3("dirLight.specular", glm::vec3(0.5f));
+		shader.setFloat("material.shininess", 32.0f);
+		glFinish();
+		double submit = 0.0;
+		start = Clock::now();
+		for (int f = 0; f < frames; f++)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			Clock::time_point frame = Clock::now();
+			if (mode == 0)
+			{
+				for (int i = 0; i < instances; i++)
+				{
+					shader.setMat4("model", transforms[i]);
+					nanosuit->Draw(shader);
+				}
+			}
+			else
+				nanosuit->DrawInstanced(shader, transforms);
+			submit += msSince(frame);
+			glFinish();
+		}
+		cout << (mode ? "DrawInstanced: " : "Draw per copy: ") << submit / frames << " ms cpu submission, "
+			<< msSince(start) / frames << " ms per frame with the gpu finished" << endl;
+		pixels[mode].resize(WIDTH * HEIGHT * 4);
+		glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[mode][0]);
+	}
+	int differ = 0;
+	for (int i = 0; i < WIDTH * HEIGHT * 4; i += 4)
+		differ += memcmp(&pixels[0][i], &pixels[1][i], 4) != 0;
+	GLenum error = glGetError();
+	delete nanosuit;
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	if (error != GL_NO_ERROR)
+	{
+		cout << "GL error " << error << endl;
+		return (1);
+	}
+	if (differ)
+	{
+		cout << differ << " pixels differ between the two paths" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// nanosuit through the importer with no cooked file next to it, which writes one,
+// then straight from that file. texture decoding is the same in both
+static int benchModelLoad(void)
+{
+	const string path = "./resources/models/nanosuit/nanosuit.obj";
+	GLFWwindow *window = createHiddenWindow();
+	if (!window)
+	{
+		cout << "no GL context, skipped" << endl;
+		return (0);
+	}
+	unlink((path + ".cooked").c_str());
+	Clock::time_point start = Clock::now();
+	Model *imported = new Model(path);
+	double importMs = msSince(start);
+	start = Clock::now();
+	Model *cooked = new Model(path);
+	double cookedMs = msSince(start);
+	cout << "imported in " << importMs << " ms, cooked file loaded in " << cookedMs << " ms" << endl;
+	const vector<Mesh> &a = imported->getMeshes();
+	const vector<Mesh> &b = cooked->getMeshes();
+	bool same = a.size() == b.size() && !a.empty() && imported->getTextureCount() == cooked->getTextureCount();
+	for (unsigned int i = 0; same && i < b.size(); i++)
+		same = a[i].getIndexCount() == b[i].getIndexCount()
+			&& b[i].vertices.empty() // uploaded without a cpu copy
+			&& a[i].textures.size() == b[i].textures.size();
+	cout << b.size() << " meshes, " << cooked->getTextureCount() << " textures" << endl;
+	delete imported;
+	delete cooked;
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	if (!same)
+	{
+		cout << "cooked model doesn't match the imported one" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// time until the first frame with both skyboxes and the atlases on the gpu: one
+// image after the other with driver mipmaps like before, decoded on worker threads
+// while cooking, then mapped from the cooked files. level 0 has to come out the same
+static int benchTextures(void)
+{
+	GLFWwindow *window = createHiddenWindow();
+	if (!window)
+	{
+		cout << "no GL context, skipped" << endl;
+		return (0);
+	}
+	const string sky = "./resources/skybox/skybox/";
+	const string ely = "./resources/skybox/ely_mountain/mountain_";
+	vector<string> skyboxes[2] = {
+		{sky + "right.jpg", sky + "left.jpg", sky + "top.jpg", sky + "bottom.jpg", sky + "front.jpg", sky + "back.jpg"},
+		{ely + "rt.tga", ely + "lf.tga", ely + "up.tga", ely + "dn.tga", ely + "ft.tga", ely + "bk.tga"}};
+	const string blocks = "./resources/textures/atlas2.png";
+	vector<string> atlases = {"./resources/textures/atlas.png", "./resources/textures/atlas3.jpg",
+		"./resources/textures/atlas4.png", "./resources/textures/myatlas.jpg"};
+	vector<string> faces = skyboxes[0];
+	faces.insert(faces.end(), skyboxes[1].begin(), skyboxes[1].end());
+	vector<string> all = atlases;
+	all.insert(all.end(), faces.begin(), faces.end());
+	unlink((blocks + ".cooked").c_str());
+	for (unsigned int i = 0; i < all.size(); i++)
+		unlink((all[i] + ".cooked").c_str());
+
+	const char *modes[3] = {"one by one, no cache", "worker threads, cooking", "mapped from the cooked files"};
+	vector<unsigned char> pixels[3];
+	for (int mode = 0; mode < 3; mode++)
+	{
+		glFinish();
+		Clock::time_point start = Clock::now();
+		TextureEngine textures;
+		textures.cache = mode > 0;
+		if (mode)
+		{
+			textures.preload(vector<string>(1, blocks), ATLAS_TILES);
+			textures.preload(atlases);
+			textures.preload(faces, 0, false);
+		}
+		vector<unsigned int> ids;
+		ids.push_back(textures.loadTextureArray(blocks.c_str(), ATLAS_TILES));
+		for (unsigned int i = 0; i < atlases.size(); i++)
+			ids.push_back(textures.loadTexture(atlases[i].c_str()));
+		ids.push_back(textures.loadCubemap(skyboxes[0]));
+		ids.push_back(textures.loadCubemap(skyboxes[1]));
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glFinish();
+		cout << modes[mode] << ": first frame after " << msSince(start) << " ms" << endl;
+
+		// the block atlas and a skybox face, as the gpu holds them
+		pixels[mode].resize(1024 * 1024 * 4 + 2048 * 2048 * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, ids[0]);
+		glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[mode][0]);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, ids[ids.size() - 2]);
+		glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[mode][1024 * 1024 * 4]);
+		glDeleteTextures(ids.size(), &ids[0]);
+	}
+	GLenum error = glGetError();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	if (error != GL_NO_ERROR)
+	{
+		cout << "GL error " << error << endl;
+		return (1);
+	}
+	if (pixels[0] != pixels[1] || pixels[0] != pixels[2])
+	{
+		cout << "cooked textures differ from the decoded ones" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// startup cost of building every shader program: compiled from source, compiled and
+// saved to an empty program cache, then loaded back from it
+static int benchShaders(void)
+{
+	GLFWwindow *window = createHiddenWindow();
+	if (!window)
+	{
+		cout << "no GL context, skipped" << endl;
+		return (0);
+	}
+	const string dir = "./resources/shaders/";
+	const char *programs[6][2] = {{"cube.vs", "cube.fs"}, {"model_shader.vs", "model_shader.fs"},
+		{"model_instanced.vs", "model_shader.fs"}, {"lamp.vs", "lamp.fs"}, {"shader.vs", "shader.fs"}, {"skybox.vs", "skybox.fs"}};
+	DIR *cache = opendir(SHADER_CACHE);
+	for (struct dirent *entry; cache && (entry = readdir(cache));)
+		if (entry->d_name[0] != '.')
+			unlink((string(SHADER_CACHE) + entry->d_name).c_str());
+	if (cache)
+		closedir(cache);
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	cout << formats << " program binary formats" << endl;
+
+	const char *modes[3] = {"compiled", "compiled and cached", "loaded from the cache"};
+	GLint uniforms[3] = {0, 0, 0};
+	for (int mode = 0; mode < 3; mode++)
+	{
+		glFinish();
+		Clock::time_point start = Clock::now();
+		vector<Shader> shaders;
+		for (int i = 0; i < 6; i++)
+			shaders.push_back(Shader((dir + programs[i][0]).c_str(), (dir + programs[i][1]).c_str(), mode > 0));
+		glFinish();
+		cout << modes[mode] << ": " << msSince(start) << " ms" << endl;
+		for (int i = 0; i < 6; i++)
+		{
+			GLint count = 0, linked = 0;
+			glGetProgramiv(shaders[i].ID, GL_LINK_STATUS, &linked);
+			glGetProgramiv(shaders[i].ID, GL_ACTIVE_UNIFORMS, &count);
+			uniforms[mode] += linked ? count : -1000;
+			glDeleteProgram(shaders[i].ID);
+		}
+	}
+	GLenum error = glGetError();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	if (error != GL_NO_ERROR)
+	{
+		cout << "GL error " << error << endl;
+		return (1);
+	}
+	if (uniforms[0] <= 0 || uniforms[0] != uniforms[1] || uniforms[0] != uniforms[2])
+	{
+		cout << "cached programs don't match the compiled ones" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+static void deleteWorld(Terrain *t)
+{
+	for (auto it = t->world.begin(); it != t->world.end(); it++)
+		delete it->second;
+	delete t;
+}
+
+// time to the full render radius around the spawn without uploads: one updateChunk
+// after the other in render order like the render loop did before the pipeline, a frame
+// each, against Terrain::pregenerate on one thread and on every core
+static int benchSpawn(void)
+{
+	const int radius = RENDER_RADIUS;
+	const int chunks = (radius * 2 - 1) * (radius * 2 - 1);
+	int cores = max(1, (int)thread::hardware_concurrency());
+	for (int mode = 0; mode < 3; mode++)
+	{
+		Terrain *t = new Terrain(BENCH_SEED);
+		Clock::time_point start = Clock::now();
+		if (mode == 0)
+		{
+			t->staged = false;
+			t->sortRenderOrder(glm::ivec2(0, 0), radius);
+			for (size_t i = 0; i < t->renderOrder.size(); i++)
+				t->updateChunk(t->renderOrder[i]);
+		}
+		else
+			t->pregenerate(glm::ivec2(0, 0), radius, NULL, mode == 1 ? 1 : cores);
+		double ms = msSince(start);
+		long vertices = 0;
+		int ready = 0;
+		for (auto it = t->world.begin(); it != t->world.end(); it++)
+		{
+			// the pipeline leaves the rings its edge depends on generated but not meshed
+			if (max(abs(it->first.x), abs(it->first.y)) >= radius)
+				continue ;
+			ready += it->second->getState() == RENDER;
+			vertices += it->second->getVertexCount();
+		}
+		cout << (mode == 0 ? "chunk by chunk: " : mode == 1 ? "pregenerate, 1 thread: " : "pregenerate, all cores: ")
+			<< ms << " ms for " << chunks << " chunks, " << vertices / chunks << " vertices per chunk";
+		if (mode == 0)
+			cout << " (plus " << chunks << " frames in the render loop)";
+		else if (mode == 2)
+			cout << " (" << cores << " threads)";
+		cout << endl;
+		deleteWorld(t);
+		if (ready != chunks)
+		{
+			cout << chunks - ready << " chunks not ready" << endl;
+			return (1);
+		}
+	}
+	return (0);
+}
+
+// loopback load test: a server thread streams radius 8 around two spawns to 8 simulated
+// clients, then every client sends edits one at a time and waits for the server's answer
+static int benchServer(void)
+{
+	const int players = 8;
+	const int radius = 8;
+	const int edits = 50;
+	const int perClient = (radius * 2 - 1) * (radius * 2 - 1);
+	Terrain *t = new Terrain(BENCH_SEED);
+	ServerEngine *server = new ServerEngine(t, 0);
+	if (!server->getPort())
+	{
+		cout << "could not listen on loopback, skipped" << endl;
+		delete server;
+		deleteWorld(t);
+		return (0);
+	}
+	atomic<bool> running(true);
+	thread serverThread([&]() {
+		while (running)
+			server->update(1);
+	});
+
+	vector<ClientEngine *> clients;
+	bool connected = true;
+	for (int i = 0; i < players; i++)
+	{
+		clients.push_back(new ClientEngine(NULL));
+		connected &= clients[i]->connect("127.0.0.1", server->getPort());
+		clients[i]->setView(glm::ivec2((i % 2) * radius, 0), radius);
+	}
+	Clock::time_point start = Clock::now();
+	bool done = false;
+	while (connected && !done && msSince(start) < 120000.0)
+	{
+		done = true;
+		for (int i = 0; i < players; i++)
+		{
+			connected &= clients[i]->update();
+			done &= clients[i]->chunksReceived == perClient;
+		}
+		this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	double streamMs = msSince(start);
+	long chunks = 0, bytes = 0;
+	for (int i = 0; i < players; i++)
+	{
+		chunks += clients[i]->chunksReceived;
+		bytes += clients[i]->bytesReceived;
+	}
+	cout << chunks << " chunks to " << players << " clients in " << streamMs << " ms, " << chunks / (streamMs / 1000.0)
+		<< " chunks/s, " << bytes / max(chunks, 1L) << " bytes per chunk (" << CHUNK_X * CHUNK_Y * CHUNK_Z << " raw)" << endl;
+
+	vector<double> latency;
+	for (int e = 0; connected && done && e < edits; e++)
+		for (int i = 0; connected && i < players; i++)
+		{
+			glm::ivec3 pos((i % 2) * radius * CHUNK_X + e % CHUNK_X, 200 + i, e / CHUNK_X);
+			Clock::time_point sent = Clock::now();
+			uint32_t id = clients[i]->sendEdit(pos, Blocktype::STONE_BLOCK);
+			while ((connected &= clients[i]->update()) && clients[i]->lastEdit != id && msSince(sent) < 1000.0)
+				;
+			latency.push_back(msSince(sent));
+		}
+	sort(latency.begin(), latency.end());
+	if (!latency.empty())
+		cout << "edit round trip: " << latency[latency.size() / 2] << " ms median, " << latency[latency.size() * 99 / 100]
+			<< " ms p99, " << latency.back() << " ms max" << endl;
+
+	running = false;
+	serverThread.join();
+	long applied = server->editsApplied;
+	Block *b = t->getChunk(glm::ivec2(0, 0))->getBlock(0, 200, 0);
+	bool stone = b && b->getType() == Blocktype::STONE_BLOCK;
+	for (int i = 0; i < players; i++)
+		delete clients[i];
+	delete server;
+	deleteWorld(t);
+	if (!connected || !done || applied != players * edits || !stone)
+	{
+		cout << "load test failed: " << (connected ? "" : "lost a connection, ") << chunks << " of " << players * perClient
+			<< " chunks, " << applied << " of " << players * edits << " edits applied" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// 100 simulated bots on a 10x10 grid of overlapping views edit random blocks around
+// them while an observer with a real terrain stops reading for a while and falls behind.
+// deltas sent against one message per edit and a whole chunk per edit, and at the end
+// the observer's blocks against the server's
+static int benchBots(void)
+{
+	const int bots = 100;
+	const int radius = 3;
+	const int rounds = 100;
+	const int editsPerRound = 2;
+	const int perBot = (radius * 2 - 1) * (radius * 2 - 1);
+	const glm::ivec2 watch(9, 9);
+	const int watchRadius = 4;
+	Terrain *t = new Terrain(BENCH_SEED);
+	ServerEngine *server = new ServerEngine(t, 0);
+	if (!server->getPort())
+	{
+		cout << "could not listen on loopback, skipped" << endl;
+		delete server;
+		deleteWorld(t);
+		return (0);
+	}
+	atomic<bool> running(true);
+	thread serverThread([&]() {
+		while (running)
+			server->update(1);
+	});
+
+	vector<ClientEngine *> clients;
+	bool connected = true;
+	for (int i = 0; i < bots; i++)
+	{
+		clients.push_back(new ClientEngine(NULL));
+		connected &= clients[i]->connect("127.0.0.1", server->getPort());
+		clients[i]->setView(glm::ivec2(i % 10, i / 10) * 2, radius);
+	}
+	Terrain *seen = new Terrain(BENCH_SEED);
+	seen->generate = false;
+	ClientEngine *observer = new ClientEngine(seen);
+	connected &= observer->connect("127.0.0.1", server->getPort());
+	observer->setView(watch, watchRadius);
+	auto stream = [&](int observerChunks) {
+		Clock::time_point start = Clock::now();
+		bool done = false;
+		while (connected && !done && msSince(start) < 120000.0)
+		{
+			done = (connected &= observer->update()) && observer->chunksReceived >= observerChunks;
+			for (int i = 0; i < bots; i++)
+			{
+				connected &= clients[i]->update();
+				done &= clients[i]->chunksReceived == perBot;
+			}
+			this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return (done);
+	};
+	Clock::time_point start = Clock::now();
+	bool done = stream((watchRadius * 2 - 1) * (watchRadius * 2 - 1));
+	cout << bots << " bots and an observer streamed in " << msSince(start) << " ms" << endl;
+
+	// every bot edits its center chunk and the ring around it, shared with its neighbors
+	mt19937 rng(42);
+	const uint8_t types[4] = {Blocktype::AIR_BLOCK, Blocktype::STONE_BLOCK, Blocktype::DIRT_BLOCK, Blocktype::SAND_BLOCK};
+	start = Clock::now();
+	long sent = 0;
+	for (int r = 0; done && connected && r < rounds; r++)
+	{
+		// the observer asks for a wider view and stops reading, the chunks pile up until
+		// the server holds its batches back, then it catches up
+		if (r == rounds / 10)
+		{
+			observer->setView(watch, watchRadius * 3);
+			connected &= observer->update();
+		}
+		else if (r < rounds / 10 || r > rounds * 9 / 10)
+			connected &= observer->update();
+		for (int i = 0; i < bots; i++)
+		{
+			glm::ivec2 center = glm::ivec2(i % 10, i / 10) * 2;
+			for (int e = 0; e < editsPerRound; e++)
+			{
+				glm::ivec3 pos((center.x - 1) * CHUNK_X + rng() % (CHUNK_X * 3), 100 + rng() % 100, (center.y - 1) * CHUNK_Z + rng() % (CHUNK_Z * 3));
+				clients[i]->sendEdit(pos, types[rng() % 4]);
+				sent++;
+			}
+			connected &= clients[i]->update();
+		}
+		this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	// everything acked and the observer has its wider view, then a moment for the last batches
+	bool acked = false;
+	while (connected && !acked && msSince(start) < 120000.0)
+	{
+		acked = true;
+		for (int i = 0; i < bots; i++)
+		{
+			connected &= clients[i]->update();
+			acked &= clients[i]->lastEdit == (uint32_t)(rounds * editsPerRound);
+		}
+		this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	double editMs = msSince(start);
+	done &= stream((watchRadius * 6 - 1) * (watchRadius * 6 - 1));
+	for (Clock::time_point quiet = Clock::now(); connected && msSince(quiet) < 500.0;)
+	{
+		connected &= observer->update();
+		this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	running = false;
+	serverThread.join();
+
+	long received = 0, dropped = observer->batchesDropped;
+	for (int i = 0; i < bots; i++)
+	{
+		received += clients[i]->batchesReceived;
+		dropped += clients[i]->batchesDropped;
+	}
+	double chunkSize = (double)server->chunkBytes / max(server->chunksSent, 1L);
+	cout << server->editsApplied << " of " << sent << " edits applied in " << editMs << " ms, "
+		<< server->editsApplied / (editMs / 1000.0) << " edits/s" << endl;
+	cout << server->batchesSent << " delta batches (" << received << " to bots, " << server->batchesReplayed
+		<< " replayed from journals), " << server->chunksResent << " chunks resent to clients too far behind" << endl;
+	cout << "bytes to clients for the edits: " << server->batchBytes + server->chunksResent * (long)chunkSize << " as deltas, "
+		<< server->editsInterested * (long)(sizeof(uint32_t) + 1 + sizeof(glm::ivec3) + 1 + sizeof(uint32_t)) << " as one message per edit, "
+		<< (long)(server->editsInterested * chunkSize) << " as a chunk per edit" << endl;
+
+	// the observer's copy has to match the server block for block
+	long mismatched = 0;
+	for (auto it = seen->world.begin(); it != seen->world.end(); it++)
+	{
+		Chunk *mine = it->second;
+		Chunk *truth = t->getChunk(it->first);
+		for (int x = 0; x < CHUNK_X; x++)
+			for (int y = 0; y < CHUNK_Y; y++)
+				for (int z = 0; z < CHUNK_Z; z++)
+					mismatched += !truth || mine->getBlock(x, y, z)->getType() != truth->getBlock(x, y, z)->getType();
+	}
+	cout << "observer holds " << seen->world.size() << " chunks, " << mismatched << " blocks differ from the server" << endl;
+
+	for (int i = 0; i < bots; i++)
+		delete clients[i];
+	delete observer;
+	delete server;
+	deleteWorld(seen);
+	deleteWorld(t);
+	if (!connected || !done || !acked || dropped || mismatched)
+	{
+		cout << "bot test failed" << (connected ? "" : ", lost a connection") << (done ? "" : ", chunks missing")
+			<< (acked ? "" : ", edits unacked") << ", " << dropped << " batches out of sequence" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// the same seed has to give the same blocks whether chunks are generated one after the
+// other or on every core, and the same input the same path through them
+static int benchDeterminism(void)
+{
+	const int radius = 8;
+	const int frames = 600;
+	const float step = 1.0f / 60.0f;
+	uint64_t hashes[2];
+	vector<glm::vec3> paths[2];
+	for (int run = 0; run < 2; run++)
+	{
+		Terrain *t = new Terrain(BENCH_SEED);
+		Clock::time_point start = Clock::now();
+		t->pregenerate(glm::ivec2(0, 0), radius, NULL, run ? 0 : 1);
+		double genMs = msSince(start);
+		hashes[run] = 14695981039346656037ull;
+		for (int i = -radius + 1; i < radius; i++)
+			for (int j = -radius + 1; j < radius; j++)
+			{
+				Chunk *c = t->getChunk(glm::ivec2(i, j));
+				for (int x = 0; x < CHUNK_X; x++)
+					for (int y = 0; y < CHUNK_Y; y++)
+						for (int z = 0; z < CHUNK_Z; z++)
+							hashes[run] = (hashes[run] ^ c->getBlock(x, y, z)->getType()) * 1099511628211ull;
+			}
+		// walks in a slow circle, jumping now and then
+		Player *p = new Player(glm::vec3(CHUNK_X / 2.0f, (float)CHUNK_Y - 30.0f, CHUNK_Z / 2.0f), t);
+		start = Clock::now();
+		for (int f = 0; f < frames; f++)
+		{
+			PlayerInput input;
+			input.keys = INPUT_FORWARD | ((f % 90 == 0) ? INPUT_JUMP : 0);
+			input.yaw = f * 0.6f;
+			p->applyInput(input, step);
+			p->update(step);
+			paths[run].push_back(p->getPosition());
+		}
+		cout << (run ? "all cores" : "one thread") << ": " << genMs << " ms to generate, " << msSince(start)
+			<< " ms for " << frames << " frames of input, world hash " << hex << hashes[run] << dec << endl;
+		delete p;
+		deleteWorld(t);
+	}
+	float drift = 0.0f;
+	for (int f = 0; f < frames; f++)
+		drift = max(drift, glm::length(paths[0][f] - paths[1][f]));
+	cout << "the walk covered " << glm::length(paths[0][frames / 2] - paths[0][0]) << " blocks to its far side, "
+		<< "farthest the paths got apart: " << drift << " blocks" << endl;
+	if (hashes[0] != hashes[1] || drift != 0.0f)
+	{
+		cout << "runs differ" << endl;
+		return (1);
+	}
+	return (0);
+}
+
+// streams 1000 chunks through a radius 8 window walking along x like the render loop:
+// the column coming into view is generated and meshed, the ones UNLOAD_MARGIN behind unloaded.
+// first every chunk comes from the heap and goes back to it, then through the pool.
+// the storage alone is cycled through acquire and release without generating it
+static int benchPool(void)
+{
+	const int radius = 8;
+	const int width = radius * 2 - 1;
+	const int chunks = 1000;
+	uint64_t hashes[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		Terrain *t = new Terrain(BENCH_SEED);
+		t->chunkPool->limit = mode ? CHUNK_POOL_MAX : 0;
+		t->pregenerate(glm::ivec2(0, 0), radius, NULL, 1);
+		long allocated = allocations;
+		long created = t->chunkPool->created;
+		Clock::time_point start = Clock::now();
+		int streamed = 0;
+		for (int step = 1; streamed < chunks; step++)
+		{
+			glm::ivec2 center(step, 0);
+			t->unloadChunks(center, radius + UNLOAD_MARGIN);
+			for (int j = -radius + 1; j < radius; j++, streamed++)
+				t->updateChunk(center + glm::ivec2(radius - 1, j));
+		}
+		double ms = msSince(start);
+		allocated = allocations - allocated;
+		hashes[mode] = 14695981039346656037ull;
+		for (auto it = t->world.begin(); it != t->world.end(); it++)
+		{
+			Chunk *c = it->second;
+			hashes[mode] = (hashes[mode] ^ (c->getXOff() * 31 + c->getZOff()) ^ c->getVertexCount()) * 1099511628211ull;
+			for (int x = 0; x < CHUNK_X; x++)
+				for (int y = 0; y < CHUNK_Y; y++)
+					for (int z = 0; z < CHUNK_Z; z++)
+						hashes[mode] = (hashes[mode] ^ c->getBlock(x, y, z)->getType() ^ c->getSunLight(x, y, z) << 8) * 1099511628211ull;
+		}
+		cout << (mode ? "pooled: " : "heap: ") << ms << " ms to stream " << streamed << " chunks in and out, "
+			<< allocationCount(allocated, streamed) << ", "
+			<< t->chunkPool->created - created << " chunks allocated, " << t->chunkPool->reused << " recycled, "
+			<< t->world.size() << " loaded" << endl;
+		deleteWorld(t);
+	}
+	if (hashes[0] != hashes[1])
+	{
+		cout << "recycled chunks differ from fresh ones" << endl;
+		return (1);
+	}
+
+	// storage only, a window of live chunks with the oldest handed back for every new one
+	for (int mode = 0; mode < 2; mode++)
+	{
+		ChunkPool pool;
+		pool.limit = mode ? CHUNK_POOL_MAX : 0;
+		vector<Chunk *> live;
+		long allocated = allocations;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < chunks; i++)
+		{
+			live.push_back(pool.acquire(i, 0, NULL));
+			if (live.size() > (size_t)width)
+			{
+				pool.release(live.front());
+				live.erase(live.begin());
+			}
+		}
+		double ms = msSince(start);
+		allocated = allocations - allocated;
+		cout << (mode ? "pooled" : "heap") << " storage: " << ms << " ms for " << chunks << " chunks, "
+			<< allocationCount(allocated, chunks) << endl;
+		for (size_t i = 0; i < live.size(); i++)
+			delete live[i];
+	}
+	return (0);
+}
+
+// one terrain noise layer through FastNoise::GetNoise and through its StaticNoise twin:
+// a sample per block over 64x64 chunks like Chunk::setTerrain takes them, then random
+// points off the block grid. every sample has to have the same bits
+template <class Layer>
+static long compareNoise(const char *name, const FastNoise *dynamic, const Layer &layer)
+{
+	const int size = 1024;
+	vector<float> a(size * size);
+	vector<float> b(size * size);
+	double dynamicMs = 1e9;
+	double staticMs = 1e9;
+	for (int run = 0; run < 5; run++) // best of five, single runs are noisy
+	{
+		Clock::time_point start = Clock::now();
+		for (int z = 0; z < size; z++)
+			for (int x = 0; x < size; x++)
+				a[z * size + x] = dynamic->GetNoise(x - size / 2, z - size / 2);
+		dynamicMs = min(dynamicMs, msSince(start));
+		start = Clock::now();
+		for (int z = 0; z < size; z++)
+			for (int x = 0; x < size; x++)
+				b[z * size + x] = layer.getNoise(x - size / 2, z - size / 2);
+		staticMs = min(staticMs, msSince(start));
+	}
+	long differ = 0;
+	for (size_t i = 0; i < a.size(); i++)
+		differ += memcmp(&a[i], &b[i], sizeof(float)) != 0;
+	mt19937 random(BENCH_SEED);
+	uniform_real_distribution<float> coord(-100000.0f, 100000.0f);
+	for (int i = 0; i < 100000; i++)
+	{
+		float x = coord(random);
+		float z = coord(random);
+		float d = dynamic->GetNoise(x, z);
+		float s = layer.getNoise(x, z);
+		differ += memcmp(&d, &s, sizeof(float)) != 0;
+	}
+	double samples = (double)size * size;
+	cout << name << ": dynamic " << samples / dynamicMs / 1000.0 << " M samples/s, static "
+		<< samples / staticMs / 1000.0 << " M samples/s (" << dynamicMs / staticMs << "x), "
+		<< differ << " samples differ" << endl;
+	return (differ);
+}
+
+// every noise layer of Terrain::setNoise, then getBase and getBiome for a column as
+// Chunk::setTerrain calls them
+static int benchNoise(void)
+{
+	Terrain *t = new Terrain(BENCH_SEED);
+	long differ = 0;
+	differ += compareNoise("hills, 1 octave", t->getTerrainNoise1(), t->terrainLayer1);
+	differ += compareNoise("hills, 2 octaves", t->getTerrainNoise2(), t->terrainLayer2);
+	differ += compareNoise("hills, 3 octaves", t->getTerrainNoise3(), t->terrainLayer3);
+	differ += compareNoise("temperature", t->getTemperatureNoise(), t->temperatureLayer);
+	differ += compareNoise("humidity", t->getHumidityNoise(), t->humidityLayer);
+
+	const int size = 1024;
+	long sum = 0;
+	Clock::time_point start = Clock::now();
+	for (int z = 0; z < size; z++)
+		for (int x = 0; x < size; x++)
+			sum += t->getBase(x, z) + t->getBiome(x, z);
+	cout << "columns: " << (double)size * size / msSince(start) / 1000.0 << " M/s for getBase and getBiome (checksum " << sum << ")" << endl;
+	delete t;
+	return (differ != 0);
+}
+
+// terrain for an 8x8 area with the density lattice and with noise for every block of
+// the same sections. the lattice's caves and overhangs should follow the full
+// resolution ones closely for a fraction of the time
+static int benchDensity(void)
+{
+	const int side = 8;
+	const int count = side * side;
+	Terrain *t = new Terrain(BENCH_SEED);
+	vector<Chunk *> chunks[2];
+	double ms[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		for (int i = 0; i < count; i++)
+			chunks[mode].push_back(new Chunk(i % side - side / 2, i / side - side / 2, t));
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < count; i++)
+			chunks[mode][i]->setTerrain(mode == 1);
+		ms[mode] = msSince(start);
+	}
+	long differ = 0;
+	long carved = 0;
+	long raised = 0;
+	for (int i = 0; i < count; i++)
+		for (int x = 0; x < CHUNK_X; x++)
+			for (int z = 0; z < CHUNK_Z; z++)
+			{
+				int base = chunks[0][i]->getBase(x, z);
+				for (int y = 0; y < CHUNK_Y; y++)
+				{
+					int type = chunks[0][i]->getBlock(x, y, z)->getType();
+					differ += type != chunks[1][i]->getBlock(x, y, z)->getType();
+					carved += y < base && type == Blocktype::AIR_BLOCK;
+					raised += y >= base && type != Blocktype::AIR_BLOCK && type != Blocktype::WATER_BLOCK;
+				}
+			}
+	cout << "lattice: " << ms[0] << " ms for " << count << " chunks, " << ms[0] / count << " ms each" << endl;
+	cout << "full resolution: " << ms[1] << " ms, " << ms[1] / count << " ms each (" << ms[1] / ms[0] << "x the lattice)" << endl;
+	cout << carved / count << " blocks carved under the heightmap and " << raised / count << " over it per chunk, "
+		<< differ * 100.0 / ((double)count * CHUNK_X * CHUNK_Y * CHUNK_Z) << "% of blocks differ from the full resolution" << endl;
+	for (int mode = 0; mode < 2; mode++)
+		for (int i = 0; i < count; i++)
+			delete chunks[mode][i];
+	delete t;
+	return (0);
+}
+
+// biome surfaces for 16x16 chunks with both noises taken for every column and from the
+// cached coarse grid: noise calls and time per chunk for the biome fill alone and for
+// the whole of setTerrain, then how many columns interpolation and dithering moved.
+// last the heightmap tiles' fill at every step against getBiome a column at a time,
+// they have to match
+static int benchBiomes(void)
+{
+	const int side = 16;
+	const int count = side * side;
+	const int columns = CHUNK_X * CHUNK_Z;
+	Terrain *t = new Terrain(BENCH_SEED);
+	BiomeEngine *biomes = t->biomeEngine;
+	vector<short> types[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		biomes->coarse = mode == 1;
+		types[mode].resize(count * columns);
+		double fillMs = 1e9;
+		double generateMs = 1e9;
+		long samples = 0;
+		long misses = 0;
+		for (int run = 0; run < 5; run++) // best of five, every run from an empty cache
+		{
+			biomes->clear();
+			long before = biomes->samples;
+			long missed = biomes->misses;
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < count; i++)
+				biomes->fillChunk((i % side - side / 2) * CHUNK_X, (i / side - side / 2) * CHUNK_Z, &types[mode][i * columns]);
+			fillMs = min(fillMs, msSince(start));
+			samples = biomes->samples - before;
+			misses = biomes->misses - missed;
+		}
+		for (int run = 0; run < 3; run++)
+		{
+			biomes->clear();
+			vector<Chunk *> chunks;
+			for (int i = 0; i < count; i++)
+				chunks.push_back(new Chunk(i % side - side / 2, i / side - side / 2, t));
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < count; i++)
+				chunks[i]->setTerrain();
+			generateMs = min(generateMs, msSince(start));
+			for (int i = 0; i < count; i++)
+				delete chunks[i];
+		}
+		cout << (mode ? "coarse grid: " : "per column: ") << (double)samples / count << " noise calls per chunk";
+		if (mode)
+			cout << " (" << misses << " regions sampled)";
+		cout << ", biomes " << fillMs * 1000.0 / count << " us per chunk, setTerrain " << generateMs / count << " ms per chunk" << endl;
+	}
+	long differ = 0;
+	for (size_t i = 0; i < types[0].size(); i++)
+		differ += types[0][i] != types[1][i];
+	cout << differ * 100.0 / types[0].size() << "% of columns on another surface than with per column noise" << endl;
+
+	long mismatched = 0;
+	double columnMs = 0.0;
+	double gridMs = 0.0;
+	for (int step = 1; step <= CHUNK_X; step *= 2)
+	{
+		const int n = CHUNK_X / step + 1;
+		vector<short> grid(n * n);
+		for (int i = 0; i < count; i++)
+		{
+			int wx = (i % side - side / 2) * CHUNK_X;
+			int wz = (i / side - side / 2) * CHUNK_Z;
+			Clock::time_point start = Clock::now();
+			biomes->fillGrid(wx, wz, step, n, n, &grid[0]);
+			gridMs += msSince(start);
+			start = Clock::now();
+			for (int x = 0; x < n; x++)
+				for (int z = 0; z < n; z++)
+					mismatched += biomes->getBiome(wx + x * step, wz + z * step) != grid[x * n + z];
+			columnMs += msSince(start);
+		}
+	}
+	cout << "heightmap tile fill: " << gridMs << " ms a chunk at a time, " << columnMs << " ms a column at a time, "
+		<< mismatched << " columns differ" << endl;
+	delete t;
+	return (mismatched != 0);
+}
+
+// the render loop loading radius 12 around the spawn from nothing, a frame at a time: a
+// request for every chunk in render order, then the frame's updates. chunk by chunk a
+// chunk is meshed as soon as it's generated, against the heightmap where a neighbor is
+// missing, and again for every neighbor whose structures spill into it. counts meshes per
+// chunk till all of them can be drawn, and the meshes that still differ from a fresh one.
+// then the spawn area with pregenerate's phases and with the pipeline
+static int benchPipeline(void)
+{
+	const int radius = 12;
+	const int chunks = (radius * 2 - 1) * (radius * 2 - 1);
+	for (int mode = 0; mode < 2; mode++)
+	{
+		Terrain *t = new Terrain(BENCH_SEED);
+		t->staged = mode == 1;
+		t->sortRenderOrder(glm::ivec2(0, 0), radius);
+		Clock::time_point start = Clock::now();
+		int frames = 0;
+		for (int ready = 0; ready < chunks; frames++)
+		{
+			ready = 0;
+			for (size_t i = 0; i < t->renderOrder.size(); i++)
+			{
+				Chunk *c = t->requestChunk(t->renderOrder[i]);
+				ready += c && c->getState() == RENDER;
+			}
+			t->pipelineEngine->update();
+			while (!t->updateList.empty())
+			{
+				t->updateChunk(t->updateList.top());
+				t->updateList.pop();
+			}
+		}
+		double ms = msSince(start);
+		long meshes = 0;
+		int again = 0;
+		int stale = 0;
+		for (size_t i = 0; i < t->renderOrder.size(); i++)
+		{
+			Chunk *c = t->getChunk(t->renderOrder[i]);
+			meshes += c->meshCount;
+			again += c->meshCount > 1;
+			int vertices = c->getVertexCount();
+			c->mesh();
+			stale += c->getVertexCount() != vertices;
+		}
+		cout << (mode ? "pipeline: " : "chunk by chunk: ") << frames << " frames, " << ms << " ms, "
+			<< (double)meshes / chunks << " meshes per chunk (" << again << " chunks meshed more than once), "
+			<< stale << " meshes out of date, " << t->world.size() << " chunks generated" << endl;
+		if (mode)
+			cout << "stages run: " << t->pipelineEngine->stages[TERRAIN_DONE] << " terrain, " << t->pipelineEngine->stages[STRUCTURES_DONE]
+				<< " structures, " << t->pipelineEngine->stages[LIGHT_DONE] << " light, " << t->pipelineEngine->stages[MESH_DONE]
+				<< " mesh, " << t->pipelineEngine->stages[UPLOAD_DONE] << " upload" << endl;
+		deleteWorld(t);
+	}
+	for (int mode = 0; mode < 2; mode++)
+	{
+		Terrain *t = new Terrain(BENCH_SEED);
+		t->staged = mode == 1;
+		Clock::time_point start = Clock::now();
+		t->pregenerate(glm::ivec2(0, 0), radius);
+		double ms = msSince(start);
+		long meshes = 0;
+		for (auto it = t->world.begin(); it != t->world.end(); it++)
+			meshes += it->second->meshCount;
+		cout << (mode ? "pregenerate, pipeline: " : "pregenerate, phases: ") << ms << " ms, " << meshes << " meshes for "
+			<< chunks << " chunks (" << max(1, (int)thread::hardware_concurrency()) << " threads)" << endl;
+		deleteWorld(t);
+	}
+	return (0);
+}
+
+struct Benchmark
+{
+	const char *name;
+	int (*run)(void);
+};
+
+static const Benchmark benchmarks[] = {
+	{"occlusion", benchOcclusion},
+	{"mesh", benchMesh},
+	{"registry", benchRegistry},
+	{"raycast", benchRaycast},
+	{"physics", benchPhysics},
+	{"entities", benchEntities},
+	{"models", benchModels},
+	{"modelload", benchModelLoad},
+	{"textures", benchTextures},
+	{"shaders", benchShaders},
+	{"spawn", benchSpawn},
+	{"server", benchServer},
+	{"bots", benchBots},
+	{"determinism", benchDeterminism},
+	{"pool", benchPool},
+	{"noise", benchNoise},
+	{"density", benchDensity},
+	{"biomes", benchBiomes},
+	{"pipeline", benchPipeline},
+};
+
+int runBenchmark(int argc, char **argv)
+{
+	const int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	for (int i = 0; i < count; i++)
+		if (argc < 3 || string(argv[2]) == benchmarks[i].name)
+		{
+			cout << "== " << benchmarks[i].name << endl;
+			if (benchmarks[i].run())
+				return (1);
+		}
+	return (0);
+}
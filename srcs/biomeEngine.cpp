@@ -0,0 +1,196 @@
+#include <engine.hpp>
+#include <biomeEngine.hpp>
+#include <terrain.hpp>
+
+static_assert(BIOME_REGION % CHUNK_X == 0 && BIOME_REGION % CHUNK_Z == 0, "a chunk has to fit in one region");
+static_assert(CHUNK_X % BIOME_STEP == 0 && CHUNK_Z % BIOME_STEP == 0, "chunk borders on the biome grid");
+
+BiomeEngine::~BiomeEngine(void)
+{
+	this->clear();
+}
+
+void BiomeEngine::clear(void)
+{
+	lock_guard<mutex> guard(this->lock);
+	for (auto it = this->regions.begin(); it != this->regions.end(); it++)
+		delete it->second.first;
+	this->regions.clear();
+	this->used.clear();
+}
+
+// noise layer #1 "Temperature"
+// noise layer #2 "Humidity"
+short BiomeEngine::biomeType(float temp, float hum)
+{
+	short blocktype;
+	(temp < -0.33f) ?
+		(hum < 0.0f) ? blocktype = Blocktype::TUNDRA_BLOCK : blocktype = Blocktype::TAIGA_BLOCK
+		: (temp >= 0.33f) ?
+			(hum < 0.0f) ? blocktype = Blocktype::GRASS_BLOCK : blocktype = Blocktype::DIRT_BLOCK
+			: (hum < 0.0f) ? blocktype = Blocktype::SAND_BLOCK : blocktype = Blocktype::GRASS_BLOCK;
+	return (blocktype);
+}
+
+short BiomeEngine::exact(int x, int z)
+{
+	this->samples += 2;
+	return (biomeType(this->terr->temperatureLayer.getNoise(x, z), this->terr->humidityLayer.getNoise(x, z)));
+}
+
+// a column's interpolated climate moved by a hash of its position, the same column
+// always lands on the same side of a border
+short BiomeEngine::blend(float temperature, float humidity, int x, int z)
+{
+	uint32_t h = (uint32_t)x * 0x85ebca77u ^ (uint32_t)z * 0xc2b2ae3du ^ (uint32_t)this->terr->getSeed();
+	h ^= h >> 15;
+	h *= 0x2c1b3c6du;
+	h ^= h >> 12;
+	temperature += ((h & 0xffff) / 32767.5f - 1.0f) * BIOME_DITHER;
+	humidity += ((h >> 16) / 32767.5f - 1.0f) * BIOME_DITHER;
+	return (biomeType(temperature, humidity));
+}
+
+// both noises on the region's grid, without the lock
+void BiomeEngine::sample(glm::ivec2 pos, BiomeRegion &r)
+{
+	for (int i = 0; i < BIOME_SAMPLES; i++)
+		for (int j = 0; j < BIOME_SAMPLES; j++)
+		{
+			int x = pos.x * BIOME_REGION + i * BIOME_STEP;
+			int z = pos.y * BIOME_REGION + j * BIOME_STEP;
+			r.temperature[i][j] = this->terr->temperatureLayer.getNoise(x, z);
+			r.humidity[i][j] = this->terr->humidityLayer.getNoise(x, z);
+		}
+	this->samples += BIOME_SAMPLES * BIOME_SAMPLES * 2;
+}
+
+// the least recently used region makes room once the cache is full. another thread
+// may have sampled the same region meanwhile, then the copies are the same. called
+// with the lock held
+void BiomeEngine::insert(glm::ivec2 pos, const BiomeRegion &sampled)
+{
+	auto it = this->regions.find(pos);
+	if (it != this->regions.end())
+		return ;
+	BiomeRegion *r;
+	if ((int)this->regions.size() >= max(1, this->capacity))
+	{
+		auto last = this->regions.find(this->used.back());
+		r = last->second.first;
+		this->regions.erase(last);
+		this->used.pop_back();
+	}
+	else
+		r = new BiomeRegion();
+	*r = sampled;
+	this->used.push_front(pos);
+	this->regions[pos] = make_pair(r, this->used.begin());
+}
+
+static inline void copyPoints(const BiomeRegion &r, int i0, int j0, int nx, int nz, float *temperature, float *humidity)
+{
+	for (int i = 0; i < nx; i++)
+		for (int j = 0; j < nz; j++)
+		{
+			temperature[i * nz + j] = r.temperature[i0 + i][j0 + j];
+			humidity[i * nz + j] = r.humidity[i0 + i][j0 + j];
+		}
+}
+
+// nx by nz grid points of the region at pos if it's cached. copied under the lock,
+// another thread may recycle the region right after
+bool BiomeEngine::copyCached(glm::ivec2 pos, int i0, int j0, int nx, int nz, float *temperature, float *humidity)
+{
+	lock_guard<mutex> guard(this->lock);
+	auto it = this->regions.find(pos);
+	if (it == this->regions.end())
+		return (false);
+	this->used.splice(this->used.begin(), this->used, it->second.second);
+	copyPoints(*it->second.first, i0, j0, nx, nz, temperature, humidity);
+	return (true);
+}
+
+// nx by nz grid points from world x, z on, all inside one region. a missing region is
+// sampled outside the lock so the other generation threads don't wait behind it
+void BiomeEngine::copyGrid(int x, int z, int nx, int nz, float *temperature, float *humidity)
+{
+	glm::ivec2 pos(floorDiv(x, BIOME_REGION), floorDiv(z, BIOME_REGION));
+	int i0 = (x - pos.x * BIOME_REGION) / BIOME_STEP;
+	int j0 = (z - pos.y * BIOME_REGION) / BIOME_STEP;
+	if (this->copyCached(pos, i0, j0, nx, nz, temperature, humidity))
+	{
+		this->hits++;
+		return ;
+	}
+	this->misses++;
+	BiomeRegion r;
+	this->sample(pos, r);
+	copyPoints(r, i0, j0, nx, nz, temperature, humidity);
+	lock_guard<mutex> guard(this->lock);
+	this->insert(pos, r);
+}
+
+// a column on a grid line doesn't read the next grid point, it may be past the copied ones
+static inline float bilinear(const float *grid, int nz, int i, int j, float fx, float fz)
+{
+	float a = grid[i * nz + j];
+	float b = fz ? grid[i * nz + j + 1] : a;
+	if (fx)
+	{
+		a += (grid[(i + 1) * nz + j] - a) * fx;
+		if (fz)
+			b += (grid[(i + 1) * nz + j + 1] - b) * fx;
+	}
+	return (a + (b - a) * fz);
+}
+
+// surface block type, in world block coordinates
+short BiomeEngine::getBiome(int x, int z)
+{
+	if (!this->coarse)
+		return (this->exact(x, z));
+	int cx = floorDiv(x, BIOME_STEP) * BIOME_STEP;
+	int cz = floorDiv(z, BIOME_STEP) * BIOME_STEP;
+	float temperature[4];
+	float humidity[4];
+	this->copyGrid(cx, cz, 2, 2, temperature, humidity);
+	float fx = (x - cx) / (float)BIOME_STEP;
+	float fz = (z - cz) / (float)BIOME_STEP;
+	return (this->blend(bilinear(temperature, 2, 0, 0, fx, fz), bilinear(humidity, 2, 0, 0, fx, fz), x, z));
+}
+
+// every column of the chunk at world wx, wz from one trip to the cache
+void BiomeEngine::fillChunk(int wx, int wz, short *types)
+{
+	this->fillGrid(wx, wz, 1, CHUNK_X, CHUNK_Z, types);
+}
+
+void BiomeEngine::fillGrid(int wx, int wz, int step, int nx, int nz, short *types)
+{
+	if (!this->coarse)
+	{
+		for (int i = 0; i < nx; i++)
+			for (int j = 0; j < nz; j++)
+				types[i * nz + j] = this->exact(wx + i * step, wz + j * step);
+		return ;
+	}
+	// grid points up to the cell of the last column, or just its line when it's on one
+	const int spanX = (nx - 1) * step;
+	const int spanZ = (nz - 1) * step;
+	const int gx = spanX / BIOME_STEP + (spanX % BIOME_STEP != 0) + 1;
+	const int gz = spanZ / BIOME_STEP + (spanZ % BIOME_STEP != 0) + 1;
+	float temperature[BIOME_SAMPLES * BIOME_SAMPLES];
+	float humidity[BIOME_SAMPLES * BIOME_SAMPLES];
+	this->copyGrid(wx, wz, gx, gz, temperature, humidity);
+	for (int i = 0; i < nx; i++)
+		for (int j = 0; j < nz; j++)
+		{
+			int x = i * step;
+			int z = j * step;
+			float fx = (x % BIOME_STEP) / (float)BIOME_STEP;
+			float fz = (z % BIOME_STEP) / (float)BIOME_STEP;
+			types[i * nz + j] = this->blend(bilinear(temperature, gz, x / BIOME_STEP, z / BIOME_STEP, fx, fz),
+				bilinear(humidity, gz, x / BIOME_STEP, z / BIOME_STEP, fx, fz), wx + x, wz + z);
+		}
+}
\ No newline at end of file
@@ -1,83 +1,82 @@
 #include <engine.hpp>
 #include <chunk.hpp>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
-#define YSQRT sqrt(CHUNK_Y-1)
-
-Chunk::Chunk(int x, int z, Terrain *t) : xoff(x), zoff(z), terr(t)
+Chunk::Chunk(int x, int z, Terrain *t) : terr(t)
 {
+	// one slab per map behind the pointer tables, six allocations instead of 8k
+	this->blockData = new Block[CHUNK_X * CHUNK_Y * CHUNK_Z];
+	this->lightData = new uint8_t[CHUNK_X * CHUNK_Y * CHUNK_Z];
 	this->blocks = new Block**[CHUNK_X];
 	this->lightMap = new uint8_t**[CHUNK_X];
+	Block **blockRows = new Block*[CHUNK_X * CHUNK_Y];
+	uint8_t **lightRows = new uint8_t*[CHUNK_X * CHUNK_Y];
 	for(int i = 0; i < CHUNK_X; i++)
 	{
-		this->blocks[i] = new Block*[CHUNK_Y];
-		this->lightMap[i] = new uint8_t*[CHUNK_Y];
+		this->blocks[i] = blockRows + i * CHUNK_Y;
+		this->lightMap[i] = lightRows + i * CHUNK_Y;
 		for(int j = 0; j < CHUNK_Y; j++)
 		{
-			this->blocks[i][j] = new Block[CHUNK_Z];
-			this->lightMap[i][j] = new uint8_t[CHUNK_Z]();
+			this->blocks[i][j] = this->blockData + (i * CHUNK_Y + j) * CHUNK_Z;
+			this->lightMap[i][j] = this->lightData + (i * CHUNK_Y + j) * CHUNK_Z;
 		}
 	}
+	this->reset(x, z);
+}
+
+// a blank chunk at x, z as if it was just constructed, the storage and the gl
+// buffers stay and are filled again by the next generation and upload
+void Chunk::reset(int x, int z)
+{
+	this->xoff = x;
+	this->zoff = z;
+	std::fill(this->blockData, this->blockData + CHUNK_X * CHUNK_Y * CHUNK_Z, Block());
+	memset(this->lightData, 0, CHUNK_X * CHUNK_Y * CHUNK_Z);
+	this->state = GENERATE;
+	this->stage = NOTHING_DONE;
+	this->meshCount = 0;
+	this->neighborsSet = false;
+	this->edited = false;
+	this->xMinus = this->xPlus = this->zMinus = this->zPlus = NULL;
+	this->neighborQueue.clear();
+	this->spilled.clear();
+	for (int f = 0; f < 6; f++)
+		this->faceMesh[f].clear();
+	this->transparentMesh.clear();
 
 	this->pointSize = 0;
 	this->transparentPointSize = 0;
+	for (int f = 0; f < 6; f++)
+		this->faceCount[f] = this->faceStart[f] = 0;
+	for (int s = 0; s < SECTIONS; s++)
+	{
+		this->sectionGraph[s] = ~0ull; // open until meshed
+		this->sectionVisit[s] = -1;
+	}
+	this->visibleFrame = -1;
 	offsetMatrix = glm::translate(glm::mat4(1.0f), glm::vec3((float)(xoff * CHUNK_X), 1.0f, (float)(zoff * CHUNK_Z)));
 	offsetMatrix = glm::translate(offsetMatrix, glm::vec3(0.5f, -0.5f, 0.5f));
+	this->maxHeight = CHUNK_Y;
+	for (int i = 0; i < OCCLUDER_CELLS * OCCLUDER_CELLS; i++)
+		this->occluderTop[i] = 0;
+}
 
-	// non transparent
-	// cout << x << " " << z << endl;
-	// this segfaults on multithreaded generation?
-	glGenVertexArrays(1, &this->VAO);
-	// cout << "NO SEG!" << endl;
-	glGenBuffers(1, &this->VBO);
-	glBindVertexArray(this->VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+static void initVertexArray(unsigned int &VAO, unsigned int &VBO)
+{
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
 		// vertices
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BlockVertex), (GLvoid*)0);
 		glEnableVertexAttribArray(0);
-		
-		// textures
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(1);
-
-		// normals
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(5 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(2);
-
-		// torch light
-		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(3);
-
-		// sun light
-		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(9 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(4);
-	glBindVertexArray(0);	
 
-	// transparent
-	glGenVertexArrays(1, &this->transparentVAO);
-	glGenBuffers(1, &this->transparentVBO);
-	glBindVertexArray(this->transparentVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, this->transparentVBO);
-
-		// vertices
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)0);
-		glEnableVertexAttribArray(0);
-		
-		// textures
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+		// texture layer, corner, face and lighting, unpacked in cube.vs
+		glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(BlockVertex), (GLvoid*)offsetof(BlockVertex, data));
 		glEnableVertexAttribArray(1);
-
-		// normals
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(5 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(2);
-
-		// torch light
-		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(8 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(3);
-
-		// sun light
-		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), (GLvoid*)(9 * sizeof(GLfloat)));
-		glEnableVertexAttribArray(4);
 	glBindVertexArray(0);
 }
 
@@ -112,139 +111,190 @@ void Chunk::setBlock(glm::ivec3 pos, Blocktype type)
 Chunk::~Chunk(void)
 {
 	this->cleanVAO();
-	for(int i = 0; i < CHUNK_X; i++)
-	{
-		for(int j = 0; j < CHUNK_Y; j++)
-		{
-			delete this->blocks[i][j];
-			delete this->lightMap[i][j];
-		}
-		delete this->blocks[i];
-		delete this->lightMap[i];
-	}
-	delete this->blocks;
-	delete this->lightMap;
+	delete[] this->blocks[0];
+	delete[] this->lightMap[0];
+	delete[] this->blocks;
+	delete[] this->lightMap;
+	delete[] this->blockData;
+	delete[] this->lightData;
 }
 
-void Chunk::render(Shader shader)
+void Chunk::render(Shader shader, glm::vec3 viewPos, RenderStats &stats)
 {
+	bool facing[6];
+	facing[0] = viewPos.y < this->facePlane[0]; // DOWN
+	facing[1] = viewPos.y > this->facePlane[1]; // UP
+	facing[2] = viewPos.x > this->facePlane[2]; // xpos
+	facing[3] = viewPos.z > this->facePlane[3]; // zpos
+	facing[4] = viewPos.x < this->facePlane[4]; // xneg
+	facing[5] = viewPos.z < this->facePlane[5]; // zneg
+
 	shader.setMat4("transform", this->offsetMatrix);
 	shader.setFloat("transparency", 1.0f);
 	glBindVertexArray(VAO);
-	glDrawArrays(GL_TRIANGLES, 0, this->pointSize);
+	// one draw per run of neighbouring buckets that face the camera
+	for (int f = 0; f < 6;)
+	{
+		if (!facing[f])
+		{
+			stats.facesSkipped += this->faceCount[f] / 6;
+			f++;
+			continue ;
+		}
+		int start = this->faceStart[f];
+		int count = 0;
+		while (f < 6 && (facing[f] || !this->faceCount[f]))
+			count += this->faceCount[f++];
+		if (count)
+		{
+			glDrawArrays(GL_TRIANGLES, start, count);
+			stats.drawCalls++;
+			stats.vertices += count;
+		}
+	}
 	glBindVertexArray(0);
+	stats.chunks++;
 }
 
-void Chunk::renderWater(Shader shader)
+void Chunk::renderWater(Shader shader, RenderStats &stats)
 {
+	if (!this->transparentPointSize)
+		return ;
 	shader.setMat4("transform", offsetMatrix);
 	shader.setFloat("transparency", 0.65f);
 	glBindVertexArray(transparentVAO);
 	glDrawArrays(GL_TRIANGLES, 0, transparentPointSize);
 	glBindVertexArray(0);
+	stats.drawCalls++;
+	stats.vertices += transparentPointSize;
+}
+
+// neighbor a queued block outside the chunk goes to, x sides first so a corner
+// block is passed on again by that neighbor
+Chunk *Chunk::spillTarget(glm::ivec3 pos)
+{
+	if (pos.x < 0)
+		return (this->xMinus);
+	if (pos.z < 0)
+		return (this->zMinus);
+	if (pos.x >= CHUNK_X)
+		return (this->xPlus);
+	return (this->zPlus);
 }
 
 // could also check neighbors to see if they have any blocks for this chunk, could be faster?
 void Chunk::neighborQueueUnload()
 {
 	vector<blockQueue> temp;
-	for (int i = 0; i < neighborQueue.size(); i++)
+	for (size_t i = 0; i < neighborQueue.size(); i++)
 	{
-		if (neighborQueue[i].pos.x < 0 && this->getXMinus())
-		{
-			this->getXMinus()->setBlock(glm::ivec3(CHUNK_X+neighborQueue[i].pos.x,
-				neighborQueue[i].pos.y, neighborQueue[i].pos.z), neighborQueue[i].type);
-			this->getXMinus()->setState(UPDATE);
-		}
-		else if (neighborQueue[i].pos.x < 0)
-		{
-			temp.push_back(neighborQueue[i]);
-		}
-		else if (neighborQueue[i].pos.z < 0 && this->getZMinus())
-		{
-			this->getZMinus()->setBlock(glm::ivec3(neighborQueue[i].pos.x,
-				neighborQueue[i].pos.y, CHUNK_Z+neighborQueue[i].pos.z), neighborQueue[i].type);
-			this->getZMinus()->setState(UPDATE);
-		}
-		else if (neighborQueue[i].pos.z < 0)
-		{
-			temp.push_back(neighborQueue[i]);
-		}
-		else if (neighborQueue[i].pos.x >= CHUNK_X && this->getXPlus())
-		{
-			this->getXPlus()->setBlock(glm::ivec3(neighborQueue[i].pos.x-CHUNK_X,
-				neighborQueue[i].pos.y, neighborQueue[i].pos.z), neighborQueue[i].type);
-			this->getXPlus()->setState(UPDATE);
-		}
-		else if (neighborQueue[i].pos.x >= CHUNK_X)
+		Chunk *n = this->spillTarget(neighborQueue[i].pos);
+		if (!n)
 		{
 			temp.push_back(neighborQueue[i]);
+			continue ;
 		}
+		glm::ivec3 p = neighborQueue[i].pos;
+		if (p.x < 0)
+			p.x += CHUNK_X;
+		else if (p.z < 0)
+			p.z += CHUNK_Z;
+		else if (p.x >= CHUNK_X)
+			p.x -= CHUNK_X;
+		else
+			p.z -= CHUNK_Z;
+		n->setBlock(p, neighborQueue[i].type);
+		if (n->getState() == RENDER) // one not meshed yet has the block when it is
+			n->setState(UPDATE);
+		this->spilled.push_back(neighborQueue[i]);
+	}
+	neighborQueue.clear();
+	neighborQueue = temp;
+}
 
-		else if (neighborQueue[i].pos.z >= CHUNK_Z && this->getZPlus())
+// gone is leaving the world: what was handed to it waits in the queue for the chunk
+// generated there next, and setNeighbors links that side again
+void Chunk::forgetNeighbor(Chunk *gone)
+{
+	for (size_t i = this->spilled.size(); i-- > 0;)
+		if (this->spillTarget(this->spilled[i].pos) == gone)
 		{
-			this->getZPlus()->setBlock(glm::ivec3(neighborQueue[i].pos.x,
-				neighborQueue[i].pos.y, neighborQueue[i].pos.z-CHUNK_Z), neighborQueue[i].type);
-			this->getZPlus()->setState(UPDATE);
+			this->neighborQueue.push_back(this->spilled[i]);
+			this->spilled[i] = this->spilled.back();
+			this->spilled.pop_back();
 		}
-		else if (neighborQueue[i].pos.z >= CHUNK_Z)
+	if (this->xMinus == gone)
+		this->xMinus = NULL;
+	if (this->xPlus == gone)
+		this->xPlus = NULL;
+	if (this->zMinus == gone)
+		this->zMinus = NULL;
+	if (this->zPlus == gone)
+		this->zPlus = NULL;
+	this->neighborsSet = false;
+}
+
+// the blocks the structures of the 8 chunks around spilled into this one, taken from
+// their neighborQueue or, once handed out, their spilled list. around is the 3x3 of
+// chunks centered on this one, x major. only reads the others, so the chunks of an area
+// can pull side by side
+void Chunk::pullTerrainFromNeighbors(Chunk *around[9])
+{
+	for (int i = 0; i < 9; i++)
+	{
+		Chunk *n = around[i];
+		if (!n || n == this)
+			continue ;
+		glm::ivec2 d(this->xoff - n->xoff, this->zoff - n->zoff);
+		for (int list = 0; list < 2; list++)
 		{
-			temp.push_back(neighborQueue[i]);
+			const vector<blockQueue> &q = list ? n->neighborQueue : n->spilled;
+			for (size_t j = 0; j < q.size(); j++)
+			{
+				glm::ivec3 p = q[j].pos;
+				if (floorDiv(p.x, CHUNK_X) == d.x && floorDiv(p.z, CHUNK_Z) == d.y && p.y >= 0 && p.y < CHUNK_Y)
+					this->blocks[p.x - d.x * CHUNK_X][p.y][p.z - d.y * CHUNK_Z].setType(q[j].type);
+			}
 		}
 	}
-	neighborQueue.clear();
-	neighborQueue = temp;
 }
 
-void Chunk::pullTerrainFromNeighbors()
+// heightmap generation
+int	Chunk::getBase(int x, int z)
 {
-	if (this->getXMinus())
-		this->getXMinus()->neighborQueueUnload();
-	if (this->getZMinus())
-		this->getZMinus()->neighborQueueUnload();
-	if (this->getXPlus())
-		this->getXPlus()->neighborQueueUnload();
-	if (this->getZPlus())
-		this->getZPlus()->neighborQueueUnload();
-	this->setState(RENDER); //reset state because it doesn't need the update that neighborqueueunload does
+	return (this->terr->getBase(x+(CHUNK_X*xoff), z+(CHUNK_Z*zoff)));
 }
 
-// heightmap generation
-int	Chunk::getBase(int x, int z)
+// xorshift, seeded from the world seed and the chunk so structures land in the same
+// spots every run whichever thread generates the chunk, which rand() couldn't promise
+static inline uint32_t chunkRandom(uint32_t &state)
 {
-	float b1 = MAP(this->terr->terrainNoise1->GetNoise(x+(CHUNK_X*xoff),z+(CHUNK_Z*zoff)), -1.0f, 1.0f, 0.1f, YSQRT);
-	// float b2 = MAP(this->terr->terrainNoise2.GetNoise(x+(CHUNK_X*xoff),z+(CHUNK_Z*zoff)), -1.0f, 1.0f, 0.1f, YSQRT);
-	// float b3 = MAP(this->terr->terrainNoise3.GetNoise(x+(CHUNK_X*xoff),z+(CHUNK_Z*zoff)), -1.0f, 1.0f, 0.1f, YSQRT);
-	// return (pow((b1+b2+b3)/3, 2));
-	return (pow(b1, 2));
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state);
 }
 
-void Chunk::setTerrain()
+void Chunk::setTerrain(bool fullDensity)
 {
 	// std::clock_t	start;
 	// start = std::clock();
 
+	uint32_t random = (uint32_t)this->terr->getSeed() * 0x9e3779b1u ^ (uint32_t)this->xoff * 0x85ebca77u ^ (uint32_t)this->zoff * 0xc2b2ae3du;
+	random = (random ^ (random >> 16)) | 1;
+	int bases[CHUNK_X][CHUNK_Z];
+	short types[CHUNK_X][CHUNK_Z];
+	this->terr->biomeEngine->fillChunk(CHUNK_X*xoff, CHUNK_Z*zoff, &types[0][0]);
 	/* PERLIN NOISE */
 	for (int x = 0; x < CHUNK_X; x++)
 	{
 		for (int z = 0; z < CHUNK_Z; z++)
 		{
-			bool water = false;
 			// Use the noise library to get the height value of x, z
 			int base = getBase(x,z);
-			float temp = this->terr->temperatureNoise->GetNoise(x+(CHUNK_X*xoff),z+(CHUNK_Z*zoff));
-			float hum = this->terr->humidityNoise->GetNoise(x+(CHUNK_X*xoff),z+(CHUNK_Z*zoff));
-			short blocktype;
-			// noise layer #1 "Temperature"
-			// noise layer #2 "Humidity"
-			(temp < -0.33f) ?
-				(hum < 0.0f) ? blocktype = 67 : blocktype = 68
-				: (temp >= 0.33f) ?
-					(hum < 0.0f) ? blocktype = Blocktype::GRASS_BLOCK : blocktype = Blocktype::DIRT_BLOCK
-					: (hum < 0.0f) ? blocktype = Blocktype::SAND_BLOCK : blocktype = Blocktype::GRASS_BLOCK;
-
-			if (base < WATER_LEVEL)
-				water = true;
+			short blocktype = types[x][z];
+			bases[x][z] = base;
+
 			for (int y = 0; y < base - 4; y++)
 			{
 				this->blocks[x][y][z].setType(Blocktype::STONE_BLOCK);
@@ -255,42 +305,183 @@ void Chunk::setTerrain()
 			}
 			for (int y = base; y < WATER_LEVEL; y++)
 			{
-				water = true;
 				this->blocks[x][y][z].setType(Blocktype::WATER_BLOCK);
 			}
+		}
+	}
+	this->carveDensity(bases, types, fullDensity);
+
+	// extras, on top of whatever the density left of the column
+	for (int x = 0; x < CHUNK_X; x++)
+	{
+		for (int z = 0; z < CHUNK_Z; z++)
+		{
+			int top = min(CHUNK_Y - 1, bases[x][z] + DENSITY_HEIGHT);
+			while (top > 0 && this->blocks[x][top][z].getType() == Blocktype::AIR_BLOCK)
+				top--;
+			if (this->blocks[x][top][z].getType() == Blocktype::WATER_BLOCK)
+				continue ;
+			short blocktype = this->blocks[x][top][z].getType();
+			glm::ivec3 loc(x, top + 1, z);
+			if (blocktype == Blocktype::GRASS_BLOCK && chunkRandom(random) % 10000 > 9996)
+				this->terr->structureEngine->addStructure(this, loc, StructType::Tree);
+			else if (blocktype == Blocktype::GRASS_BLOCK && chunkRandom(random) % 10000 > 9998)
+				this->terr->structureEngine->addStructure(this, loc, StructType::GiantTree);
+
+			if (blocktype == Blocktype::SAND_BLOCK && chunkRandom(random) % 1000 > 998)
+				this->terr->structureEngine->addStructure(this, loc, StructType::Cactus);
+			else if (blocktype == Blocktype::SAND_BLOCK && chunkRandom(random) % 1000 > 998)
+				this->terr->structureEngine->addStructure(this, loc, StructType::Rock);
+		}
+	}
+	// std::cout << (std::clock() - start) / (double)(CLOCKS_PER_SEC / 1000) << std::endl;
+}
 
-			// extras
-			if (!water)
+// a land column's block at height y for density noise n: cave where the noise is high
+// enough under the crust, otherwise solid up to the heightmap moved by the noise.
+// ground eroded under the water level fills with water like the sea next to it
+static inline void applyDensity(Block &b, int y, float n, int base, short type)
+{
+	if (n > CAVE_LEVEL && y < base - CAVE_CRUST && y >= CAVE_FLOOR)
+		b.setType(Blocktype::AIR_BLOCK);
+	else if ((float)(base - y) + n * DENSITY_SQUASH > 0.0f)
+	{
+		if (y >= base)
+			b.setType(type); // overhang
+	}
+	else if (y < base)
+		b.setType(y < WATER_LEVEL ? Blocktype::WATER_BLOCK : Blocktype::AIR_BLOCK);
+}
+
+#ifdef __SSE2__
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t)
+{
+	return (_mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a))));
+}
+#endif
+
+// 3d noise on a lattice around the surface, only through the sections between
+// DENSITY_DEPTH under the lowest land column and DENSITY_HEIGHT over the highest:
+// the rest of the chunk stays the heightmap's without a single sample. columns
+// under water keep their sea floor
+void Chunk::carveDensity(int base[CHUNK_X][CHUNK_Z], short type[CHUNK_X][CHUNK_Z], bool fullDensity)
+{
+	const int latticeX = CHUNK_X / DENSITY_STEP_X + 1;
+	const int latticeY = CHUNK_Y / DENSITY_STEP_Y + 1;
+	const int latticeZ = CHUNK_Z / DENSITY_STEP_Z + 1;
+	static_assert(DENSITY_STEP_Z == 4 && latticeZ <= 8, "a lattice row is blended 4 blocks at a time");
+	int low = CHUNK_Y;
+	int high = -1;
+	for (int x = 0; x < CHUNK_X; x++)
+		for (int z = 0; z < CHUNK_Z; z++)
+			if (base[x][z] >= WATER_LEVEL)
 			{
-				if (blocktype == Blocktype::GRASS_BLOCK && rand() % 10000 > 9996)
-					this->terr->structureEngine->addStructure(this,glm::ivec3(x,base,z), StructType::Tree);
-				else if (blocktype == Blocktype::GRASS_BLOCK && rand() % 10000 > 9998)
-					this->terr->structureEngine->addStructure(this,glm::ivec3(x,base,z), StructType::GiantTree);
-
-				if (blocktype == Blocktype::SAND_BLOCK && rand() % 1000 > 998)
-					this->terr->structureEngine->addStructure(this,glm::ivec3(x,base,z), StructType::Cactus);
-				else if (blocktype == Blocktype::SAND_BLOCK && rand() % 1000 > 998)
-					this->terr->structureEngine->addStructure(this,glm::ivec3(x,base,z), StructType::Rock);
+				low = min(low, base[x][z]);
+				high = max(high, base[x][z]);
 			}
+	if (high < 0)
+		return ;
+	int first = max(0, low - DENSITY_DEPTH) / SECTION_Y * SECTION_Y;
+	int last = min(CHUNK_Y, ((high + DENSITY_HEIGHT) / SECTION_Y + 1) * SECTION_Y);
+	FastNoise *noise = this->terr->densityNoise;
+	int wx = this->xoff * CHUNK_X;
+	int wz = this->zoff * CHUNK_Z;
+
+	if (fullDensity)
+	{
+		for (int x = 0; x < CHUNK_X; x++)
+			for (int z = 0; z < CHUNK_Z; z++)
+				if (base[x][z] >= WATER_LEVEL)
+					for (int y = first; y < last; y++)
+						applyDensity(this->blocks[x][y][z], y, noise->GetNoise(wx + x, y, wz + z), base[x][z], type[x][z]);
+		return ;
+	}
+
+	float lattice[latticeX][latticeY][8];
+	for (int i = 0; i < latticeX; i++)
+		for (int j = 0; j <= (last - first) / DENSITY_STEP_Y; j++)
+			for (int k = 0; k < latticeZ; k++)
+				lattice[i][j][k] = noise->GetNoise(wx + i * DENSITY_STEP_X, first + j * DENSITY_STEP_Y, wz + k * DENSITY_STEP_Z);
+
+	float row[CHUNK_Z];
+	for (int x = 0; x < CHUNK_X; x++)
+	{
+		int i = x / DENSITY_STEP_X;
+		float fx = (float)(x % DENSITY_STEP_X) / DENSITY_STEP_X;
+		for (int y = first; y < last; y++)
+		{
+			int j = (y - first) / DENSITY_STEP_Y;
+			float fy = (float)((y - first) % DENSITY_STEP_Y) / DENSITY_STEP_Y;
+#ifdef __SSE2__
+			// lattice points 0-3 and 1-4 along z blended in x and y, then each
+			// pair spread over the 4 blocks between them
+			__m128 tx = _mm_set1_ps(fx);
+			__m128 ty = _mm_set1_ps(fy);
+			__m128 near = lerp4(lerp4(_mm_loadu_ps(&lattice[i][j][0]), _mm_loadu_ps(&lattice[i + 1][j][0]), tx),
+				lerp4(_mm_loadu_ps(&lattice[i][j + 1][0]), _mm_loadu_ps(&lattice[i + 1][j + 1][0]), tx), ty);
+			__m128 far = lerp4(lerp4(_mm_loadu_ps(&lattice[i][j][1]), _mm_loadu_ps(&lattice[i + 1][j][1]), tx),
+				lerp4(_mm_loadu_ps(&lattice[i][j + 1][1]), _mm_loadu_ps(&lattice[i + 1][j + 1][1]), tx), ty);
+			float n[4];
+			float f[4];
+			_mm_storeu_ps(n, near);
+			_mm_storeu_ps(f, far);
+			const __m128 lane = _mm_set_ps(0.75f, 0.5f, 0.25f, 0.0f);
+			for (int k = 0; k < 4; k++)
+				_mm_storeu_ps(row + k * 4, lerp4(_mm_set1_ps(n[k]), _mm_set1_ps(f[k]), lane));
+#else
+			for (int z = 0; z < CHUNK_Z; z++)
+			{
+				int k = z / DENSITY_STEP_Z;
+				float fz = (float)(z % DENSITY_STEP_Z) / DENSITY_STEP_Z;
+				float c[2];
+				for (int e = 0; e < 2; e++)
+				{
+					float a = lattice[i][j][k + e] + fx * (lattice[i + 1][j][k + e] - lattice[i][j][k + e]);
+					float b = lattice[i][j + 1][k + e] + fx * (lattice[i + 1][j + 1][k + e] - lattice[i][j + 1][k + e]);
+					c[e] = a + fy * (b - a);
+				}
+				row[z] = c[0] + fz * (c[1] - c[0]);
+			}
+#endif
+			for (int z = 0; z < CHUNK_Z; z++)
+				if (base[x][z] >= WATER_LEVEL)
+					applyDensity(this->blocks[x][y][z], y, row[z], base[x][z], type[x][z]);
 		}
 	}
-	// might not actually need to pull terrain from neighbors here:
-	// this->pullTerrainFromNeighbors();
-	// std::cout << (std::clock() - start) / (double)(CLOCKS_PER_SEC / 1000) << std::endl;
 }
 
 void Chunk::update()
 {
-	this->transparentPointSize = 0;
-	this->pointSize = 0;
+	this->mesh();
+	this->buildVAO();
+}
 
+// everything update does before the upload, only reads the neighbors so chunks
+// can be meshed side by side once none of them is being generated
+void Chunk::mesh()
+{
+	this->clearFaces();
 	this->faceRendering();
-	this->buildVAO();
+	this->buildSectionGraph();
+	this->buildOccluder();
+	this->meshCount++;
 }
 
-void Chunk::faceRendering()
+void Chunk::clearFaces()
+{
+	this->transparentPointSize = 0;
+	this->pointSize = 0;
+	for (int f = 0; f < 6; f++)
+	{
+		this->faceCount[f] = 0;
+		// UP, xpos and zpos track their lowest plane, the rest their highest
+		this->facePlane[f] = (f == 1 || f == 2 || f == 3) ? INT_MAX : INT_MIN;
+	}
+}
+
+// per block reference mesher, kept to check faceRendering against (--bench mesh)
+void Chunk::faceRenderingReference()
 {
-	bool transparent;
 	int xMinusCheck;
 	int yMinusCheck;
 	int zMinusCheck;
@@ -303,11 +494,10 @@ void Chunk::faceRendering()
 		{
 			for (int z = 0; z < CHUNK_Z; z++)
 			{
-				transparent = false;
-				if (this->blocks[x][y][z].getType() == Blocktype::AIR_BLOCK)
+				int type = this->blocks[x][y][z].getType();
+				if (!(BLOCKS.flags[type] & BLOCK_MESHED))
 					continue ;
-				if (this->blocks[x][y][z].getType() == Blocktype::WATER_BLOCK) //Blocktype::water_BLOCK
-					transparent = true;
+				bool transparent = BLOCKS.flags[type] & BLOCK_TRANSPARENT;
 				int val = this->getWorld(x, y, z);
 
 				// MINUS checks
@@ -374,36 +564,178 @@ void Chunk::faceRendering()
 				else
 					yPlusCheck = this->blocks[x][y+1][z].getType();
 
-				// Facing
-				if (!transparent)
+				// Facing: a face shows unless its neighbor is opaque, or for see through
+				// blocks the same type (no faces between water blocks)
+				const uint8_t *flags = BLOCKS.flags;
+				if (flags[yMinusCheck] & flags[yPlusCheck] & flags[xPlusCheck] & flags[zPlusCheck]
+					& flags[xMinusCheck] & flags[zMinusCheck] & BLOCK_OPAQUE)
+					continue ; // buried
+				int visible = (~flags[yMinusCheck] & BLOCK_OPAQUE) | (~flags[yPlusCheck] & BLOCK_OPAQUE) << 1
+					| (~flags[xPlusCheck] & BLOCK_OPAQUE) << 2 | (~flags[zPlusCheck] & BLOCK_OPAQUE) << 3
+					| (~flags[xMinusCheck] & BLOCK_OPAQUE) << 4 | (~flags[zMinusCheck] & BLOCK_OPAQUE) << 5;
+				if (transparent) // only the water surface (and its underside) is meshed
+					visible &= (yMinusCheck != type) | (yPlusCheck != type) << 1;
+				for (int f = 0; f < 6; f++)
 				{
-					if (yMinusCheck==Blocktype::AIR_BLOCK || yMinusCheck==Blocktype::WATER_BLOCK)
-						this->addFace(0, x , y, z, val, &this->mesh, &this->pointSize); //DOWN
-					if (yPlusCheck==Blocktype::AIR_BLOCK || yPlusCheck==Blocktype::WATER_BLOCK)
-						this->addFace(1, x , y, z, val, &this->mesh, &this->pointSize); //UP
-					if (xPlusCheck==Blocktype::AIR_BLOCK || xPlusCheck==Blocktype::WATER_BLOCK)
-						this->addFace(2, x , y, z, val, &this->mesh, &this->pointSize); //xpos SIDE
-					if (zPlusCheck==Blocktype::AIR_BLOCK || zPlusCheck==Blocktype::WATER_BLOCK)
-						this->addFace(3, x , y, z, val, &this->mesh, &this->pointSize); //zpos SIDE
-					if (xMinusCheck==Blocktype::AIR_BLOCK || xMinusCheck==Blocktype::WATER_BLOCK)
-						this->addFace(4, x , y, z, val, &this->mesh, &this->pointSize); //xneg SIDE
-					if (zMinusCheck==Blocktype::AIR_BLOCK || zMinusCheck==Blocktype::WATER_BLOCK)
-						this->addFace(5, x , y, z, val, &this->mesh, &this->pointSize); //zneg SIDE
+					if (!(visible & (1 << f)))
+						continue ;
+					if (transparent)
+						this->addFace(f, x, y, z, val, &this->transparentMesh, &this->transparentPointSize);
+					else
+						this->addOpaqueFace(f, x, y, z, val);
 				}
+			}
+		}
+	}
+}
+
+// 256 bit column helpers, bit y of word y / 64 is the block at height y.
+// above: bit y is bit y + 1 of m, below: bit y is bit y - 1 of m, the bit shifted
+// in past the chunk's top or bottom is `fill`
+static inline void above(const uint64_t *m, uint64_t *out, uint64_t fill)
+{
+	out[0] = m[0] >> 1 | m[1] << 63;
+	out[1] = m[1] >> 1 | m[2] << 63;
+	out[2] = m[2] >> 1 | m[3] << 63;
+	out[3] = m[3] >> 1 | fill << 63;
+}
+
+static inline void below(const uint64_t *m, uint64_t *out, uint64_t fill)
+{
+	out[3] = m[3] << 1 | m[2] >> 63;
+	out[2] = m[2] << 1 | m[1] >> 63;
+	out[1] = m[1] << 1 | m[0] >> 63;
+	out[0] = m[0] << 1 | fill;
+}
+
+// bits [0, height)
+static inline void columnBelow(uint64_t *out, int height)
+{
+	for (int w = 0; w < CHUNK_Y / 64; w++)
+	{
+		int bits = glm::clamp(height - w * 64, 0, 64);
+		out[w] = (bits == 64) ? ~0ull : (1ull << bits) - 1;
+	}
+}
+
+// same faces as faceRenderingReference, found for a whole column at a time: every
+// column's opaque and water blocks are packed into 256 bit masks (the border columns
+// of the neighbor chunks included) and each face direction is one shift and and-not
+void Chunk::faceRendering()
+{
+	const int W = CHUNK_Y / 64;
+	// opaque columns with a ring of border columns, [x + 1][z + 1]
+	uint64_t opaque[CHUNK_X + 2][CHUNK_Z + 2][W];
+	uint64_t water[CHUNK_X][CHUNK_Z][W];
+	memset(opaque, 0, sizeof(opaque));
+	memset(water, 0, sizeof(water));
+
+	static_assert(sizeof(Block) == 1 && CHUNK_Z == 16, "a row of blocks along z is read as two words");
+	static_assert(BLOCKS.flags[AIR_BLOCK] == 0, "air rows are skipped without lookups");
+	int top = 0; // above the highest non air block
+	for (int x = 0; x < CHUNK_X; x++)
+	{
+		for (int y = 0; y < CHUNK_Y; y++)
+		{
+			uint64_t row[2];
+			memcpy(row, this->blocks[x][y], sizeof(row));
+			if (!(row[0] | row[1])) // all air, most of the chunk above the ground
+				continue ;
+			top = max(top, y + 1);
+			uint64_t bit = 1ull << (y & 63);
+			if (row[0] == row[1] && row[0] == (row[0] & 0xff) * 0x0101010101010101ull)
+			{
+				// one type across the row, like the stone underground: one lookup
+				uint8_t flags = BLOCKS.flags[row[0] & 0xff];
+				if (flags & BLOCK_OPAQUE)
+					for (int z = 0; z < CHUNK_Z; z++)
+						opaque[x + 1][z + 1][y >> 6] |= bit;
+				else if (flags & BLOCK_TRANSPARENT)
+					for (int z = 0; z < CHUNK_Z; z++)
+						water[x][z][y >> 6] |= bit;
+				continue ;
+			}
+			for (int z = 0; z < CHUNK_Z; z++)
+			{
+				uint8_t flags = BLOCKS.flags[this->blocks[x][y][z].getType()];
+				opaque[x + 1][z + 1][y >> 6] |= (uint64_t)(flags & BLOCK_OPAQUE) << (y & 63);
+				water[x][z][y >> 6] |= (uint64_t)((flags & BLOCK_TRANSPARENT) >> 1) << (y & 63);
+			}
+		}
+	}
+	// border columns come from the neighbor when it's loaded, otherwise the heightmap.
+	// only rows below this chunk's highest block can hide any of its faces
+	for (int side = 0; side < 4; side++)
+	{
+		Chunk *n = (side == 0) ? this->xMinus : (side == 1) ? this->xPlus : (side == 2) ? this->zMinus : this->zPlus;
+		for (int i = 0; i < CHUNK_X; i++)
+		{
+			int x = (side == 0) ? -1 : (side == 1) ? CHUNK_X : i;
+			int z = (side == 2) ? -1 : (side == 3) ? CHUNK_Z : i;
+			uint64_t *col = opaque[x + 1][z + 1];
+			if (!n)
+			{
+				columnBelow(col, getBase(x, z));
+				continue ;
+			}
+			Block **rows = n->blocks[(x + CHUNK_X) % CHUNK_X];
+			int nz = (z + CHUNK_Z) % CHUNK_Z;
+			for (int y = 0; y < top; y++)
+				col[y >> 6] |= (uint64_t)(BLOCKS.flags[rows[y][nz].getType()] & BLOCK_OPAQUE) << (y & 63);
+		}
+	}
+
+	uint64_t visible[6][W];
+	uint64_t shifted[W];
+	for (int x = 0; x < CHUNK_X; x++)
+	{
+		for (int z = 0; z < CHUNK_Z; z++)
+		{
+			const uint64_t *o = opaque[x + 1][z + 1];
+			const uint64_t *t = water[x][z];
+			// blocks outside the chunk vertically count as opaque, like the reference
+			below(o, shifted, 1);
+			for (int w = 0; w < W; w++)
+				visible[0][w] = o[w] & ~shifted[w];
+			above(o, shifted, 1);
+			for (int w = 0; w < W; w++)
+				visible[1][w] = o[w] & ~shifted[w];
+			for (int w = 0; w < W; w++)
+			{
+				visible[2][w] = o[w] & ~opaque[x + 2][z + 1][w];
+				visible[3][w] = o[w] & ~opaque[x + 1][z + 2][w];
+				visible[4][w] = o[w] & ~opaque[x][z + 1][w];
+				visible[5][w] = o[w] & ~opaque[x + 1][z][w];
+			}
+			for (int f = 0; f < 6; f++)
+			{
+				for (int w = 0; w < W; w++)
+				{
+					for (uint64_t bits = visible[f][w]; bits; bits &= bits - 1)
+					{
+						int y = w * 64 + __builtin_ctzll(bits);
+						this->addOpaqueFace(f, x, y, z, this->getWorld(x, y, z));
+					}
+				}
+			}
+
+			// water only has its top and bottom meshed, against blocks that are neither opaque nor water
+			uint64_t filled[W];
+			for (int w = 0; w < W; w++)
+				filled[w] = o[w] | t[w];
+			for (int f = 0; f < 2; f++)
+			{
+				if (f == 0)
+					below(filled, shifted, 1);
 				else
+					above(filled, shifted, 1);
+				for (int w = 0; w < W; w++)
 				{
-					if (yMinusCheck==Blocktype::AIR_BLOCK || (yMinusCheck==Blocktype::WATER_BLOCK && this->blocks[x][y][z].getType() != Blocktype::WATER_BLOCK))
-						this->addFace(0, x , y, z, val, &this->transparentMesh, &this->transparentPointSize); //DOWN
-					if (yPlusCheck==Blocktype::AIR_BLOCK || (yPlusCheck==Blocktype::WATER_BLOCK && this->blocks[x][y][z].getType() != Blocktype::WATER_BLOCK))
-						this->addFace(1, x , y, z, val, &this->transparentMesh, &this->transparentPointSize); //UP
-					//FOR WATER BLOCKS SIDES // if (xPlusCheck==Blocktype::AIR_BLOCK || (xPlusCheck==Blocktype::WATER_BLOCK && this->blocks[x][y][z].getType() != Blocktype::WATER_BLOCK))
-					// 	this->addFace(2, x , y, z, val, &this->transparentMesh, &this->transparentPointSize); //xpos SIDE
-					// if (zPlusCheck==Blocktype::AIR_BLOCK || (zPlusCheck==Blocktype::WATER_BLOCK && this->blocks[x][y][z].getType() != Blocktype::WATER_BLOCK))
-					// 	this->addFace(3, x , y, z, val, &this->transparentMesh, &this->transparentPointSize); //zpos SIDE
-					// if (xMinusCheck==Blocktype::AIR_BLOCK || (xMinusCheck==Blocktype::WATER_BLOCK && this->blocks[x][y][z].getType() != Blocktype::WATER_BLOCK))
-					// 	this->addFace(4, x , y, z, val, &this->transparentMesh, &this->transparentPointSize); //xneg SIDE
-					// if (zMinusCheck==Blocktype::AIR_BLOCK || (zMinusCheck==Blocktype::WATER_BLOCK && this->blocks[x][y][z].getType() != Blocktype::WATER_BLOCK))
-					// 	this->addFace(5, x , y, z, val, &this->transparentMesh, &this->transparentPointSize); //zneg SIDE
+					for (uint64_t bits = t[w] & ~shifted[w]; bits; bits &= bits - 1)
+					{
+						int y = w * 64 + __builtin_ctzll(bits);
+						this->addFace(f, x, y, z, this->getWorld(x, y, z), &this->transparentMesh, &this->transparentPointSize);
+					}
 				}
 			}
 		}
@@ -412,77 +744,222 @@ void Chunk::faceRendering()
 
 void Chunk::buildVAO(void)
 {
+	if (!glfwGetCurrentContext()) // headless (benchmarks), nothing to upload to
+	{
+		for (int f = 0; f < 6; f++)
+			this->faceMesh[f].clear();
+		this->transparentMesh.clear();
+		this->setState(RENDER);
+		return ;
+	}
+	if (!this->VAO)
+		initVertexArray(this->VAO, this->VBO);
+	size_t total = 0;
+	for (int f = 0; f < 6; f++)
+		total += this->faceMesh[f].size();
 	glBindVertexArray(this->VAO);
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(float), &this->mesh[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, total * sizeof(BlockVertex), NULL, GL_STATIC_DRAW);
+		size_t offset = 0;
+		for (int f = 0; f < 6; f++)
+		{
+			glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(BlockVertex), this->faceMesh[f].size() * sizeof(BlockVertex), this->faceMesh[f].data());
+			this->faceStart[f] = offset;
+			offset += this->faceMesh[f].size();
+			this->faceMesh[f].clear(); // don't need after mesh is built
+		}
 	glBindVertexArray(0);
-	mesh.clear(); // don't need after mesh is built
 
-	glBindVertexArray(this->transparentVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
-		glBufferData(GL_ARRAY_BUFFER, transparentMesh.size() * sizeof(float), &this->transparentMesh[0], GL_STATIC_DRAW);
-	glBindVertexArray(0);
+	// most chunks are dry and never get water buffers
+	if (!this->transparentMesh.empty() && !this->transparentVAO)
+		initVertexArray(this->transparentVAO, this->transparentVBO);
+	if (this->transparentVAO)
+	{
+		glBindVertexArray(this->transparentVAO);
+			glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
+			glBufferData(GL_ARRAY_BUFFER, transparentMesh.size() * sizeof(BlockVertex), this->transparentMesh.data(), GL_STATIC_DRAW);
+		glBindVertexArray(0);
+	}
 	transparentMesh.clear(); // don't need after mesh is built
 	this->setState(RENDER);
 }
 
+// flood fills each section through non opaque blocks and records which of its
+// faces can see each other, the same idea as minecraft's cave culling
+void Chunk::buildSectionGraph(void)
+{
+	const int size = CHUNK_X * SECTION_Y * CHUNK_Z;
+	int stack[size];
+	bool visited[size];
+
+	for (int s = 0; s < SECTIONS; s++)
+	{
+		uint64_t graph = 0;
+		int base = s * SECTION_Y;
+		for (int i = 0; i < size; i++)
+			visited[i] = false;
+		for (int i = 0; i < size; i++)
+		{
+			if (visited[i] || this->blocks[i / (SECTION_Y * CHUNK_Z)][base + (i / CHUNK_Z) % SECTION_Y][i % CHUNK_Z].isOpaque())
+				continue ;
+			int faces = 0;
+			int top = 0;
+			stack[top++] = i;
+			visited[i] = true;
+			while (top)
+			{
+				int c = stack[--top];
+				int x = c / (SECTION_Y * CHUNK_Z);
+				int y = (c / CHUNK_Z) % SECTION_Y;
+				int z = c % CHUNK_Z;
+				faces |= (y == 0) | (y == SECTION_Y - 1) << 1 | (x == CHUNK_X - 1) << 2
+					| (z == CHUNK_Z - 1) << 3 | (x == 0) << 4 | (z == 0) << 5;
+
+				int next[6][3] = {{x, y - 1, z}, {x, y + 1, z}, {x + 1, y, z}, {x, y, z + 1}, {x - 1, y, z}, {x, y, z - 1}};
+				for (int n = 0; n < 6; n++)
+				{
+					int nx = next[n][0], ny = next[n][1], nz = next[n][2];
+					if (nx < 0 || nx >= CHUNK_X || ny < 0 || ny >= SECTION_Y || nz < 0 || nz >= CHUNK_Z)
+						continue ;
+					int ni = (nx * SECTION_Y + ny) * CHUNK_Z + nz;
+					if (visited[ni] || this->blocks[nx][base + ny][nz].isOpaque())
+						continue ;
+					visited[ni] = true;
+					stack[top++] = ni;
+				}
+			}
+			for (int a = 0; a < 6; a++)
+				for (int b = 0; b < 6; b++)
+					if ((faces >> a & 1) && (faces >> b & 1))
+						graph |= 1ull << (a * 6 + b);
+		}
+		this->sectionGraph[s] = graph;
+	}
+}
+
+void Chunk::buildOccluder(void)
+{
+	const int cellX = CHUNK_X / OCCLUDER_CELLS;
+	const int cellZ = CHUNK_Z / OCCLUDER_CELLS;
+	for (int i = 0; i < OCCLUDER_CELLS * OCCLUDER_CELLS; i++)
+		this->occluderTop[i] = CHUNK_Y;
+	this->maxHeight = 0;
+	for (int x = 0; x < CHUNK_X; x++)
+	{
+		for (int z = 0; z < CHUNK_Z; z++)
+		{
+			int solid = 0;
+			while (solid < CHUNK_Y && this->blocks[x][solid][z].isOpaque())
+				solid++;
+			int cell = (x / cellX) * OCCLUDER_CELLS + z / cellZ;
+			this->occluderTop[cell] = min(this->occluderTop[cell], solid);
+			for (int y = CHUNK_Y - 1; y >= this->maxHeight; y--)
+			{
+				if (this->blocks[x][y][z].getType() != AIR_BLOCK)
+				{
+					this->maxHeight = y + 1;
+					break ;
+				}
+			}
+		}
+	}
+}
+
+void Chunk::drawOccluder(OcclusionEngine *occlusion)
+{
+	const int cellX = CHUNK_X / OCCLUDER_CELLS;
+	const int cellZ = CHUNK_Z / OCCLUDER_CELLS;
+	for (int i = 0; i < OCCLUDER_CELLS * OCCLUDER_CELLS; i++)
+	{
+		if (!this->occluderTop[i])
+			continue ;
+		glm::vec3 mn(CHUNK_X * xoff + (i / OCCLUDER_CELLS) * cellX, 0.0f, CHUNK_Z * zoff + (i % OCCLUDER_CELLS) * cellZ);
+		occlusion->drawOccluder(mn, glm::vec3(mn.x + cellX, this->occluderTop[i], mn.z + cellZ));
+	}
+}
+
+bool Chunk::isOccluded(OcclusionEngine *occlusion)
+{
+	glm::vec3 mn(CHUNK_X * xoff, 0.0f, CHUNK_Z * zoff);
+	return (!occlusion->isVisible(mn, glm::vec3(mn.x + CHUNK_X, this->maxHeight, mn.z + CHUNK_Z)));
+}
+
+// buckets the face by direction and tracks the plane nearest the camera side
+void Chunk::addOpaqueFace(int face, int x, int y, int z, int val)
+{
+	switch (face)
+	{
+		case 0: this->facePlane[0] = max(this->facePlane[0], y); break;
+		case 1: this->facePlane[1] = min(this->facePlane[1], y + 1); break;
+		case 2: this->facePlane[2] = min(this->facePlane[2], CHUNK_X * xoff + x + 1); break;
+		case 3: this->facePlane[3] = min(this->facePlane[3], CHUNK_Z * zoff + z + 1); break;
+		case 4: this->facePlane[4] = max(this->facePlane[4], CHUNK_X * xoff + x); break;
+		case 5: this->facePlane[5] = max(this->facePlane[5], CHUNK_Z * zoff + z); break;
+	}
+	this->addFace(face, x, y, z, val, &this->faceMesh[face], &this->faceCount[face]);
+	this->pointSize += 6;
+}
+
 //can cut these down to one function by passing in the changes as variables
 
-void Chunk::addFace(int face, int x, int y, int z, int val, vector<float> *m, int *ps)
+void Chunk::addFace(int face, int x, int y, int z, int val, vector<BlockVertex> *m, int *ps)
 {
-	int xtype = (blocks[x][y][z].getType() - 1) % 16;
-	int ytype = blocks[x][y][z].getType() / 17;
+	// everything but the position and corner is the same for the whole face
+	uint32_t data = packVertex(BLOCKS.layer[blocks[x][y][z].getType()][face], glm::vec2(0.0f), face,
+		getTorchLight(x, y, z), getSunLight(x, y, z));
 	for (int i = face * 6, j = 0; i < face * 6 + 6; j++, i++)
 	{
-		// vertices
-		glm::vec3 vert(	VERTICES[INDICES[i]].x * 0.5f + (float)x,
-						VERTICES[INDICES[i]].y * 0.5f + (float)y,
-						VERTICES[INDICES[i]].z * 0.5f + (float)z);
-		m->push_back(vert.x);
-		m->push_back(vert.y);
-		m->push_back(vert.z);
-
-		// textures
-		glm::vec2 tex(TEXCOORDS[j].x, TEXCOORDS[j].y);
-		tex.x /= 16;
-
-		// if (side && grass)
-		// else if (top)
-		// else
-		if (blocks[x][y][z].getType() == GRASS_BLOCK && face != 1)
-			tex.x += 0.0625 * (xtype+1);
-		else if (blocks[x][y][z].getType() == TREE_BLOCK && (face == 1 || face == 0))
-			tex.x += 0.0625 * (xtype+1);
-		else
-			tex.x += 0.0625 * xtype;
-		
-		// if (cactus and top)
-		// else
-		tex.y /= 16;
-		if (blocks[x][y][z].getType() == CACTUS_BLOCK && (face == 1 || face == 0))
-			tex.y += 0.0625 * (ytype+1);
-		else
-			tex.y += 0.0625 * ytype;
-		m->push_back(tex.x);
-		m->push_back(tex.y);
-
-		// normals
-		m->push_back(NORMALS[INDICES[i / 6]].x);
-		m->push_back(NORMALS[INDICES[i / 6]].y);
-		m->push_back(NORMALS[INDICES[i / 6]].z);
-
-		// torch lighting, becomes a float when pushed back because mesh is a float vector
-		m->push_back(getTorchLight(x, y, z));
-		m->push_back(getSunLight(x, y, z));
+		BlockVertex v;
+		v.x = VERTICES[INDICES[i]].x * 0.5f + (float)x;
+		v.y = VERTICES[INDICES[i]].y * 0.5f + (float)y;
+		v.z = VERTICES[INDICES[i]].z * 0.5f + (float)z;
+		v.data = data | packVertex(0, TEXCOORDS[j], 0, 0, 0);
+		m->push_back(v);
 	}
 	*ps+=6;
 }
 
 void Chunk::cleanVAO(void) {
-	glDeleteBuffers(1, &this->VBO);
-	glDeleteBuffers(1, &this->transparentVBO);
-	glDeleteVertexArrays(1, &this->VAO);
-	glDeleteVertexArrays(1, &this->transparentVAO);
+	if (this->VAO)
+	{
+		glDeleteBuffers(1, &this->VBO);
+		glDeleteVertexArrays(1, &this->VAO);
+	}
+	if (this->transparentVAO)
+	{
+		glDeleteBuffers(1, &this->transparentVBO);
+		glDeleteVertexArrays(1, &this->transparentVAO);
+	}
+	this->VAO = this->VBO = this->transparentVAO = this->transparentVBO = 0;
+}
+
+ChunkPool::~ChunkPool(void)
+{
+	for (size_t i = 0; i < this->unused.size(); i++)
+		delete this->unused[i];
+}
+
+Chunk *ChunkPool::acquire(int x, int z, Terrain *t)
+{
+	if (this->unused.empty())
+	{
+		this->created++;
+		return (new Chunk(x, z, t));
+	}
+	Chunk *c = this->unused.back();
+	this->unused.pop_back();
+	c->terr = t;
+	c->reset(x, z);
+	this->reused++;
+	return (c);
+}
+
+void ChunkPool::release(Chunk *c)
+{
+	if (this->unused.size() >= this->limit)
+		delete c;
+	else
+		this->unused.push_back(c);
 }
 
 
@@ -6,22 +6,176 @@
 #include <terrain.hpp>
 #include <chunk.hpp>
 #include <player.hpp>
+#include <entityEngine.hpp>
 #include <textureEngine.hpp>
+#include <benchmark.hpp>
+#include <networkEngine.hpp>
+#include <replayEngine.hpp>
 
 float deltaTime = 0.0f;	// Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
 float lastX = WIDTH / 2.0f;
 float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
+bool replaying = false; // the mouse belongs to the replay
 TextureEngine *textureEngine = new TextureEngine();
 Terrain *terr = new Terrain();
 Player *player = new Player(glm::vec3(CHUNK_X/2.0f, (float)CHUNK_Y-30.0f, CHUNK_Z/2.0f), terr);
 
 // need to this to pass for thread
 static inline void	updatePlayer(float deltaTime){ player->update(deltaTime); }
+static inline void	updateEntities(float deltaTime){ terr->entityEngine->update(deltaTime); }
 
-int main(void)
+#define FLIGHT_SEED 1337 // --flythrough flies over the same world unless --seed says otherwise
+#define FLIGHT_STEP (1.0f / 60.0f) // simulated seconds per frame, the same frames on every machine
+#define FLIGHT_SPEED 20.0f // blocks per second, new chunks come in faster than walking
+#define FLIGHT_SWAY 48.0f // blocks to either side of the line
+
+// totals over the frames of a --flythrough
+struct FlightStats
+{
+	long drawCalls = 0;
+	int maxDrawCalls = 0;
+	long vertices = 0;
+	long maxVertices = 0;
+	long chunks = 0;
+};
+
+// --flythrough: a long line swaying from side to side high over the terrain, looking
+// ahead and down, a pure function of the time so every run sees the same frames
+static void flyTo(float time)
+{
+	float dz = FLIGHT_SWAY * 0.2f * cos(time * 0.2f);
+	player->setPosition(glm::vec3(CHUNK_X / 2.0f + time * FLIGHT_SPEED, CHUNK_Y - 40.0f, CHUNK_Z / 2.0f + FLIGHT_SWAY * sin(time * 0.2f)));
+	player->camera->SetRotation(glm::degrees(atan2(dz, FLIGHT_SPEED)), -20.0f);
+}
+
+static void writeFlightReport(const string &path, FrameTimer &timer, const FlightStats &stats, int seed, size_t spawned, size_t generated)
 {
+	ofstream out(path.c_str());
+	size_t frames = max(timer.frameCount(), (size_t)1);
+	string renderer = (const char *)glGetString(GL_RENDERER);
+	for (size_t i = 0; i < renderer.size(); i++)
+		if (renderer[i] == '"' || renderer[i] == '\\')
+			renderer.insert(i++, "\\");
+	out << "{" << endl;
+	out << "\t\"renderer\": \"" << renderer << "\"," << endl;
+	out << "\t\"seed\": " << seed << "," << endl;
+	out << "\t\"frames\": " << timer.frameCount() << "," << endl;
+	out << "\t\"simulated_seconds\": " << timer.frameCount() * FLIGHT_STEP << "," << endl;
+	out << "\t\"wall_seconds\": " << timer.total() / 1000.0 << "," << endl;
+	out << "\t\"fps\": " << timer.frameCount() / max(timer.total() / 1000.0, 1e-9) << "," << endl;
+	out << "\t\"frame_ms\": {\"p50\": " << timer.percentile(0.5f) << ", \"p95\": " << timer.percentile(0.95f)
+		<< ", \"p99\": " << timer.percentile(0.99f) << ", \"max\": " << timer.percentile(1.0f) << "}," << endl;
+	out << "\t\"stage_ms\": {";
+	for (int s = 0; s < STAGES; s++)
+		out << (s ? ", " : "") << "\"" << FrameTimer::stageName(s) << "\": " << timer.stageTotal((FrameStage)s) / frames;
+	out << "}," << endl;
+	out << "\t\"chunks_spawn\": " << spawned << "," << endl;
+	out << "\t\"chunks_generated\": " << generated << "," << endl;
+	out << "\t\"chunks_recycled\": " << terr->chunkPool->reused << "," << endl;
+	out << "\t\"chunks_drawn_per_frame\": " << (double)stats.chunks / frames << "," << endl;
+	out << "\t\"draw_calls_per_frame\": {\"avg\": " << (double)stats.drawCalls / frames << ", \"max\": " << stats.maxDrawCalls << "}," << endl;
+	out << "\t\"vertices_per_frame\": {\"avg\": " << (double)stats.vertices / frames << ", \"max\": " << stats.maxVertices << "}" << endl;
+	out << "}" << endl;
+}
+
+// called on the main thread while the spawn area generates, keeps the window responsive
+static void spawnProgress(int done, int total)
+{
+	cout << "\rgenerating spawn area " << done * 100 / max(total, 1) << "%" << flush;
+	glfwPollEvents();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && string(argv[1]) == "--bench")
+		return (runBenchmark(argc, argv));
+	// ./engine [--seed n] [--record file | --replay file | --flythrough seconds [--json file]]
+	// [--connect host[:port]], connecting renders the world of a ./server instead of generating one
+	ClientEngine *client = NULL;
+	ReplayEngine *recorder = NULL;
+	ReplayEngine *replay = NULL;
+	int seed = terr->getSeed();
+	bool seeded = false;
+	float flight = 0.0f;
+	string host, record, json = "flythrough.json";
+	for (int i = 1; i < argc; i += 2)
+	{
+		string option = argv[i];
+		if (i + 1 >= argc || (option != "--seed" && option != "--record" && option != "--replay" && option != "--connect"
+			&& option != "--flythrough" && option != "--json"))
+		{
+			cout << "usage: " << argv[0] << " [--seed n] [--record file | --replay file | --flythrough seconds [--json file]]"
+				<< " [--connect host[:port]] | --bench [name]" << endl;
+			return (1);
+		}
+		if (option == "--seed")
+		{
+			seed = atoi(argv[i + 1]);
+			seeded = true;
+		}
+		else if (option == "--flythrough")
+			flight = atof(argv[i + 1]);
+		else if (option == "--json")
+			json = argv[i + 1];
+		else if (option == "--connect")
+			host = argv[i + 1];
+		else if (option == "--record")
+			record = argv[i + 1];
+		else if (option == "--replay" && !(replay = new ReplayEngine())->load(argv[i + 1]))
+		{
+			cout << "could not read a replay from " << argv[i + 1] << endl;
+			return (1);
+		}
+	}
+	if (flight > 0.0f && (replay || !record.empty() || !host.empty()))
+	{
+		cout << "a flythrough flies on its own over a local world" << endl;
+		return (1);
+	}
+	if (flight > 0.0f)
+	{
+		if (!seeded)
+			seed = FLIGHT_SEED;
+		flyTo(0.0f);
+	}
+	if (replay)
+	{
+		seed = replay->header.seed;
+		player->setPosition(replay->header.start);
+		player->camera->SetRotation(replay->header.yaw, replay->header.pitch);
+		replaying = true;
+	}
+	else if (!record.empty() && !(recorder = new ReplayEngine())->record(record, seed, player))
+	{
+		cout << "could not write " << record << endl;
+		return (1);
+	}
+	terr->setSeed(seed);
+	if (!host.empty())
+	{
+		if (recorder || replay)
+		{
+			cout << "recordings are of a local world" << endl;
+			return (1);
+		}
+		int port = SERVER_PORT;
+		if (host.find(':') != string::npos)
+		{
+			port = atoi(host.substr(host.find(':') + 1).c_str());
+			host = host.substr(0, host.find(':'));
+		}
+		client = new ClientEngine(terr);
+		if (!client->connect(host, port))
+		{
+			cout << "could not connect to " << host << ":" << port << endl;
+			return (1);
+		}
+		terr->generate = false;
+		player->client = client;
+	}
+
 	// glfw: initialize and configure
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -31,6 +185,9 @@ int main(void)
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+	// offscreen as far as the platform goes: hidden under X11 or Xvfb, a plain buffer with OSMesa
+	if (flight > 0.0f)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
 	// glfw window creation
 	// GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Engine", glfwGetPrimaryMonitor(), NULL);
@@ -42,11 +199,14 @@ int main(void)
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	if (flight > 0.0f)
+		glfwSwapInterval(0); // frame times, not the refresh rate
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // turn on mouse capturing
 	glfwSetCursorPosCallback(window, mouse_callback); // calls mouse_callback every time mouse moves
 	glfwSetScrollCallback(window, scroll_callback); // calls scroll_callback every time scrolling happens
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
+	glfwSetKeyCallback(window, key_callback);
 	glEnable(GL_DEPTH_TEST); // turn on z buffering
 	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
 	// glEnable(GL_CULL_FACE); // face culling only renders visible faces of closed shapes ie. cube (needs speed testing to determine if worth)
@@ -55,22 +215,85 @@ int main(void)
 
 	// build and compile our shader program
 	Shader cubeShader("./resources/shaders/cube.vs", "./resources/shaders/cube.fs");
-	unsigned int atlas = textureEngine->loadTexture("./resources/textures/atlas2.png");
+	unsigned int atlas = textureEngine->loadTextureArray("./resources/textures/atlas2.png", ATLAS_TILES);
 
 	cubeShader.use();
 	cubeShader.setInt("atlas", 0);
-	int rendRadius = 4;
+
+	// the whole render radius is there on the first frame, time to full radius
+	float spawnStart = glfwGetTime();
+	glm::vec3 spawn = player->getPosition();
+	glm::ivec2 spawnChunk(floorDiv(floor(spawn.x), CHUNK_X), floorDiv(floor(spawn.z), CHUNK_Z));
+	if (client)
+	{
+		// nothing to stand on until the server sent the spawn chunk, it comes first
+		client->setView(spawnChunk, RENDER_RADIUS);
+		while (!terr->getChunk(spawnChunk) && client->update() && glfwGetTime() - spawnStart < 10.0f)
+			this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	else
+	{
+		terr->pregenerate(spawnChunk, RENDER_RADIUS, spawnProgress);
+		cout << endl << "full render radius " << RENDER_RADIUS << " in " << glfwGetTime() - spawnStart << " s" << endl;
+	}
+	int rendRadius = RENDER_RADIUS;
+	glm::ivec2 unloadCenter = spawnChunk;
+	size_t spawned = terr->world.size();
+	FlightStats flightStats;
+	int flightFrames = lround(flight / FLIGHT_STEP);
+	int frames = 0;
+
+#ifdef ENGINE_STATS
+	// fragments passing the depth test in the opaque pass, a measure of overdraw
+	unsigned int samplesQuery;
+	glGenQueries(1, &samplesQuery);
+	float lastStats = 0.0f;
+#endif
 
 	// render loop
+	FrameTimer timer;
+	lastFrame = glfwGetTime(); // the first step doesn't cover the spawn generation
 	while (!glfwWindowShouldClose(window))
 	{		
+		// a replay or a flythrough ends with its last frame
+		if ((replay && replay->done()) || (flight > 0.0f && frames == flightFrames))
+			break ;
+		timer.begin();
 		// per-frame time logic
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
-		// input
-		player->processInput(window, deltaTime);
+		// input, a replay's from its log with the time step it was recorded with
+		PlayerInput input;
+		if (flight > 0.0f)
+		{
+			deltaTime = FLIGHT_STEP;
+			flyTo(frames * FLIGHT_STEP);
+		}
+		else if (replay)
+		{
+			ReplayFrame frame;
+			replay->next(frame);
+			if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+				glfwSetWindowShouldClose(window, true);
+			deltaTime = frame.deltaTime;
+			player->applyInput(frame.input, deltaTime);
+		}
+		else
+			input = player->processInput(window, deltaTime);
+		glm::vec3 viewPos = player->getPosition();
+		glm::ivec2 center(floorDiv(floor(viewPos.x), CHUNK_X), floorDiv(floor(viewPos.z), CHUNK_Z));
+		// received chunks go into the world before the player and entity threads read it
+		if (client)
+		{
+			client->setView(center, RENDER_RADIUS);
+			if (!client->update())
+			{
+				cout << "lost the connection to the server" << endl;
+				glfwSetWindowShouldClose(window, true);
+			}
+		}
 
 		// render
 		glClearColor(0.5f, 0.7f, 0.9f, 1.0f);
@@ -78,66 +301,139 @@ int main(void)
 
 		// texture atlas binding
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, atlas);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
 
 		// setup renderer
 		cubeShader.use();
-		glm::mat4 projection = glm::perspective(glm::radians(player->camera->Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f);
+		// two depth ranges so neither runs out of 24 bit depth precision: the heightmap
+		// tiles out to the lod radius first, then the depth buffer is cleared for the
+		// chunks out to the render radius, drawn over them
+		float aspect = (float)WIDTH / (float)HEIGHT;
+		glm::mat4 projection = glm::perspective(glm::radians(player->camera->Zoom), aspect, NEAR_PLANE, RENDER_RADIUS * CHUNK_X * 1.5f);
+		glm::mat4 lodProjection = glm::perspective(glm::radians(player->camera->Zoom), aspect, LOD_NEAR_PLANE, terr->lodEngine->radius * CHUNK_X * 1.5f);
 		glm::mat4 view = player->camera->GetViewMatrix();
-		cubeShader.setMat4("projection", projection);
+		cubeShader.setMat4("projection", lodProjection);
 		cubeShader.setMat4("view", view);
 
-		Chunk *c = player->getChunk();
+		player->getChunk(); // generated right away when missing
+		terr->stats = RenderStats();
+		timer.stage(STAGE_INPUT);
 
 		thread playerMovementThread(updatePlayer, deltaTime);
+		// unstaged, renderChunk writes neighbor blocks (setNeighbors, neighborQueueUnload)
+		// so the entities wait for the chunk loop instead of reading beside it
+		thread entityThread;
+		if (terr->staged)
+			entityThread = thread(updateEntities, deltaTime);
 
-		// need to make sure to only render each chunk once per frame
-		terr->renderChunk(glm::ivec2(c->getXOff(), c->getZOff()), cubeShader);
-		for (int i = 0; i < rendRadius; i++)
-		{
-			for (int j = 0; j < rendRadius; j++)
-			{
-				if (!i && !j)
-					continue;
-				terr->renderChunk(glm::ivec2(c->getXOff() + i, c->getZOff() + j), cubeShader);
-				terr->renderChunk(glm::ivec2(c->getXOff() - i, c->getZOff() - j), cubeShader);
-				terr->renderChunk(glm::ivec2(c->getXOff() - i, c->getZOff() + j), cubeShader);
-				terr->renderChunk(glm::ivec2(c->getXOff() + i, c->getZOff() - j), cubeShader);
-			}
-		}
+#ifdef ENGINE_STATS
+		glBeginQuery(GL_SAMPLES_PASSED, samplesQuery);
+#endif
+		// heightmap tiles fill in everything past (or not yet loaded inside) the render radius
+		terr->lodEngine->update(center);
+		terr->lodEngine->render(cubeShader, center, rendRadius, terr->stats);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		cubeShader.setMat4("projection", projection);
+		timer.stage(STAGE_LOD);
 
-		terr->renderWaterChunk(glm::ivec2(c->getXOff(), c->getZOff()), cubeShader);
-		for (int i = 0; i < rendRadius; i++)
+		// opaque chunks front to back so the depth test rejects hidden fragments early,
+		// water back to front so it blends over whatever is behind it
+		terr->sortRenderOrder(center, rendRadius);
+		bool culling = terr->cullChunks(viewPos, projection * view, center, rendRadius);
+		for (size_t i = 0; i < terr->renderOrder.size(); i++)
 		{
-			for (int j = 0; j < rendRadius; j++)
+			if (culling && terr->isCulled(terr->renderOrder[i]))
 			{
-				if (!i && !j)
-					continue;
-				terr->renderWaterChunk(glm::ivec2(c->getXOff() + i, c->getZOff() + j), cubeShader);
-				terr->renderWaterChunk(glm::ivec2(c->getXOff() - i, c->getZOff() - j), cubeShader);
-				terr->renderWaterChunk(glm::ivec2(c->getXOff() - i, c->getZOff() + j), cubeShader);
-				terr->renderWaterChunk(glm::ivec2(c->getXOff() + i, c->getZOff() - j), cubeShader);
+				terr->stats.chunksCulled++;
+				continue ;
 			}
+			terr->renderChunk(terr->renderOrder[i], cubeShader, viewPos);
 		}
+		timer.stage(STAGE_CHUNKS);
+#ifdef ENGINE_STATS
+		glEndQuery(GL_SAMPLES_PASSED);
+#endif
+		for (size_t i = terr->renderOrder.size(); i-- > 0;)
+			if (!culling || !terr->isCulled(terr->renderOrder[i]))
+				terr->renderWaterChunk(terr->renderOrder[i], cubeShader);
+		timer.stage(STAGE_WATER);
 
 		playerMovementThread.join();
+		if (entityThread.joinable())
+			entityThread.join();
+		else
+			updateEntities(deltaTime);
+		if (recorder)
+			recorder->write(deltaTime, input, player->getPosition());
+		if (replay)
+			replay->check(player->getPosition());
+		timer.stage(STAGE_THREADS);
 
+		// stages of the chunks coming into view that are ready, on all cores
+		bool loading = terr->pipelineEngine->update();
 		if (!terr->updateList.empty())
 		{
 			thread t1;
 			while (!terr->updateList.empty()) // could switch to running this as a while loop on a list on a seperate thread
 			{
 				terr->updateChunk(terr->updateList.top());
-				terr->renderChunk(terr->updateList.top(), cubeShader);
+				terr->renderChunk(terr->updateList.top(), cubeShader, viewPos);
 				terr->updateList.pop();
 			}
 		}
-		else if (rendRadius < RENDER_RADIUS)
+		else if (!loading && rendRadius < RENDER_RADIUS)
 			rendRadius++;
+		// chunks left behind are recycled for the ones coming into view
+		if (center != unloadCenter)
+		{
+			if (client)
+				client->unloadChunks(center, RENDER_RADIUS + UNLOAD_MARGIN);
+			else
+				terr->unloadChunks(center, RENDER_RADIUS + UNLOAD_MARGIN);
+			unloadCenter = center;
+		}
+		timer.stage(STAGE_UPDATES);
+		flightStats.drawCalls += terr->stats.drawCalls;
+		flightStats.maxDrawCalls = max(flightStats.maxDrawCalls, terr->stats.drawCalls);
+		flightStats.vertices += terr->stats.vertices;
+		flightStats.maxVertices = max(flightStats.maxVertices, terr->stats.vertices);
+		flightStats.chunks += terr->stats.chunks;
+		frames++;
+#ifdef ENGINE_STATS
+		unsigned int samples = 0;
+		glGetQueryObjectuiv(samplesQuery, GL_QUERY_RESULT, &samples);
+		if (currentFrame - lastStats > 1.0f)
+		{
+			cout << "opaque fragments: " << samples << " faces skipped: " << terr->stats.facesSkipped
+				<< " chunks drawn: " << terr->stats.chunks << " culled: " << terr->stats.chunksCulled
+				<< " occluded: " << terr->stats.chunksOccluded << (terr->occlusionCulling ? "" : " (occlusion off)")
+				<< (terr->caveCulling ? " (section graph)" : " (radius sweep)") << endl;
+			lastStats = currentFrame;
+		}
+#endif
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		timer.stage(STAGE_SWAP);
+	}
+	if (replay)
+	{
+		timer.report();
+		cout << "farthest from the recorded path: " << replay->drift << " blocks" << endl;
+	}
+	if (flight > 0.0f)
+	{
+		timer.end();
+		writeFlightReport(json, timer, flightStats, seed, spawned, terr->chunkPool->created + terr->chunkPool->reused - spawned);
+		timer.report();
+		cout << "report written to " << json << endl;
 	}
+#ifdef ENGINE_STATS
+	glDeleteQueries(1, &samplesQuery);
+#endif
+	delete client;
+	delete recorder;
+	delete replay;
 	delete textureEngine;
 	delete terr;
 	delete player;
@@ -152,6 +448,8 @@ int main(void)
 // calculate mouse movement
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
+	if (replaying)
+		return ;
 	if (firstMouse)
 	{
 		lastX = xpos;
@@ -170,12 +468,22 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
+	// handled with the next frame's input so a recording has them
 	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
-		player->leftMouseClickEvent();
+		player->clicks |= CLICK_LEFT;
 
 	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
-		player->rightMouseClickEvent();
+		player->clicks |= CLICK_RIGHT;
+
+}
 
+// one shot toggles, held keys are polled in Player::processInput
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_C && action == GLFW_PRESS)
+		terr->caveCulling = !terr->caveCulling;
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+		terr->occlusionCulling = !terr->occlusionCulling;
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
@@ -0,0 +1,66 @@
+#include <engine.hpp>
+#include <entityEngine.hpp>
+
+int EntityEngine::spawn(glm::vec3 pos, glm::vec2 size, int model)
+{
+	this->pos.push_back(pos);
+	this->velocity.push_back(glm::vec3(0.0f));
+	this->size.push_back(size);
+	this->model.push_back(model);
+	return (this->count() - 1);
+}
+
+void EntityEngine::despawn(int id)
+{
+	int last = this->count() - 1;
+	this->pos[id] = this->pos[last];
+	this->velocity[id] = this->velocity[last];
+	this->size[id] = this->size[last];
+	this->model[id] = this->model[last];
+	this->pos.pop_back();
+	this->velocity.pop_back();
+	this->size.pop_back();
+	this->model.pop_back();
+}
+
+// walking and gravity for [begin, end), entities turn around when they run into something
+void EntityEngine::updateRange(int begin, int end, float time)
+{
+	PhysicsEngine *physics = this->terr->physicsEngine;
+	BlockAccessor blocks(this->terr); // one per worker, the cached chunk isn't shared
+	for (int i = begin; i < end; i++)
+	{
+		glm::vec3 &v = this->velocity[i];
+		int blocked = physics->walk(blocks, this->pos[i], this->size[i], glm::vec3(v.x * time, 0.0f, v.z * time));
+		if (blocked & 1)
+			v.x = -v.x;
+		if (blocked & 4)
+			v.z = -v.z;
+		float down = -v.y;
+		physics->fall(blocks, this->pos[i], this->size[i], down, time);
+		v.y = -down;
+	}
+}
+
+// splits the entities into contiguous ranges over the worker threads, blocks are
+// only read so the workers need no locking as long as nothing writes blocks during
+// the tick: the render loop only runs it beside drawing when chunks are staged.
+// threads 0 picks from the core count
+void EntityEngine::update(float time, int threads)
+{
+	int n = this->count();
+	if (threads <= 0)
+		threads = max(1, (int)thread::hardware_concurrency());
+	threads = min(threads, max(1, n / ENTITIES_PER_THREAD));
+	if (threads == 1)
+	{
+		this->updateRange(0, n, time);
+		return ;
+	}
+	vector<thread> workers;
+	for (int t = 1; t < threads; t++)
+		workers.push_back(thread(&EntityEngine::updateRange, this, n * t / threads, n * (t + 1) / threads, time));
+	this->updateRange(0, n / threads, time);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
@@ -20,8 +20,8 @@ void LightEngine::sunlightQueueClear()
 	// Currently not handling chunk edges
 	while(sunlightBfsQueue.empty() == false)
 	{
-		// Get a reference to the front node. 
-		LightNode &node = sunlightBfsQueue.front();
+		// Copy the front node, popping can free the block it lives in
+		LightNode node = sunlightBfsQueue.front();
 		chunk = node.chunk;
 		// Pop the front node off the queue. We no longer need the node reference
 		sunlightBfsQueue.pop();
@@ -37,7 +37,7 @@ void LightEngine::sunlightQueueClear()
 				// Set its light level
 				chunk->setSunLight(node.x - 1, node.y, node.z, lightLevel - 1);
 				// Emplace new node to queue. (could use push as well)
-				if (!chunk->getBlock(node.x - 1, node.y, node.z)->isActive())
+				if (!chunk->getBlock(node.x - 1, node.y, node.z)->isOpaque())
 					sunlightBfsQueue.emplace(node.x - 1, node.y, node.z, chunk);
 			}
 		}
@@ -49,8 +49,8 @@ void LightEngine::sunlightQueueClear()
 				if (lightLevel)
 					chunk->setSunLight(node.x, node.y - 1, node.z, lightLevel);
 				// cout << "2: "<< node.x << " " << node.y << " " << node.z << " light:" << lightLevel << endl;
-				// cout << "Next block active: " << chunk->getBlock(node.x, node.y - 1, node.z)->isActive() << endl;
-				if (chunk->getBlock(node.x, node.y - 1, node.z)->isActive() == false)
+				// cout << "Next block active: " << chunk->getBlock(node.x, node.y - 1, node.z)->isOpaque() << endl;
+				if (chunk->getBlock(node.x, node.y - 1, node.z)->isOpaque() == false)
 					sunlightBfsQueue.emplace(node.x, node.y - 1, node.z, chunk);
 			}
 		}
@@ -60,7 +60,7 @@ void LightEngine::sunlightQueueClear()
 			if (chunk->getSunLight(node.x, node.y, node.z - 1) + 2 <= lightLevel)
 			{
 				chunk->setSunLight(node.x, node.y, node.z - 1, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y, node.z - 1)->isActive())
+				if (!chunk->getBlock(node.x, node.y, node.z - 1)->isOpaque())
 					sunlightBfsQueue.emplace(node.x, node.y, node.z - 1, chunk);
 			}
 		}
@@ -70,7 +70,7 @@ void LightEngine::sunlightQueueClear()
 			if (chunk->getSunLight(node.x + 1, node.y, node.z) + 2 <= lightLevel)
 			{
 				chunk->setSunLight(node.x + 1, node.y, node.z, lightLevel - 1);
-				if (!chunk->getBlock(node.x + 1, node.y, node.z)->isActive())
+				if (!chunk->getBlock(node.x + 1, node.y, node.z)->isOpaque())
 					sunlightBfsQueue.emplace(node.x + 1, node.y, node.z, chunk);
 			}
 		}
@@ -80,7 +80,7 @@ void LightEngine::sunlightQueueClear()
 			if (chunk->getSunLight(node.x, node.y + 1, node.z) + 2 <= lightLevel)
 			{
 				chunk->setSunLight(node.x, node.y + 1, node.z, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y + 1, node.z)->isActive())
+				if (!chunk->getBlock(node.x, node.y + 1, node.z)->isOpaque())
 					sunlightBfsQueue.emplace(node.x, node.y + 1, node.z, chunk);
 			}
 		}
@@ -90,7 +90,7 @@ void LightEngine::sunlightQueueClear()
 			if (chunk->getSunLight(node.x, node.y, node.z + 1) + 2 <= lightLevel)
 			{
 				chunk->setSunLight(node.x, node.y, node.z + 1, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y, node.z + 1)->isActive())
+				if (!chunk->getBlock(node.x, node.y, node.z + 1)->isOpaque())
 					sunlightBfsQueue.emplace(node.x, node.y, node.z + 1, chunk);
 			}
 		}
@@ -105,8 +105,8 @@ void LightEngine::lampLighting()
 	// Currently not handling chunk edges
 	while(lightBfsQueue.empty() == false)
 	{
-		// Get a reference to the front node. 
-		LightNode &node = lightBfsQueue.front();
+		// Copy the front node, popping can free the block it lives in
+		LightNode node = lightBfsQueue.front();
 		chunk = node.chunk;
 		// Pop the front node off the queue. We no longer need the node reference
 		lightBfsQueue.pop();
@@ -121,7 +121,7 @@ void LightEngine::lampLighting()
 				// Set its light level
 				chunk->setTorchLight(node.x - 1, node.y, node.z, lightLevel - 1);
 				// Emplace new node to queue. (could use push as well)
-				if (!chunk->getBlock(node.x - 1, node.y, node.z)->isActive())
+				if (!chunk->getBlock(node.x - 1, node.y, node.z)->isOpaque())
 					lightBfsQueue.emplace(node.x - 1, node.y, node.z, chunk);
 			}
 		}
@@ -132,7 +132,7 @@ void LightEngine::lampLighting()
 				// if i can switch to just a light update that'd be best or a forced update all in one frame, OR render till can update
 				chunk->getXMinus()->setState(UPDATE);
 				chunk->getXMinus()->setTorchLight(CHUNK_X - 1, node.y, node.z, lightLevel - 1);
-				if (!chunk->getXMinus()->getBlock(CHUNK_X - 1, node.y, node.z)->isActive())
+				if (!chunk->getXMinus()->getBlock(CHUNK_X - 1, node.y, node.z)->isOpaque())
 					lightBfsQueue.emplace(CHUNK_X - 1, node.y, node.z, chunk->getXMinus());
 			}
 		}
@@ -142,7 +142,7 @@ void LightEngine::lampLighting()
 			if (chunk->getTorchLight(node.x, node.y - 1, node.z) + 2 <= lightLevel)
 			{
 				chunk->setTorchLight(node.x, node.y - 1, node.z, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y - 1, node.z)->isActive())
+				if (!chunk->getBlock(node.x, node.y - 1, node.z)->isOpaque())
 					lightBfsQueue.emplace(node.x, node.y - 1, node.z, chunk);
 			}
 		}
@@ -152,7 +152,7 @@ void LightEngine::lampLighting()
 			if (chunk->getTorchLight(node.x, node.y, node.z - 1) + 2 <= lightLevel)
 			{
 				chunk->setTorchLight(node.x, node.y, node.z - 1, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y, node.z - 1)->isActive())
+				if (!chunk->getBlock(node.x, node.y, node.z - 1)->isOpaque())
 					lightBfsQueue.emplace(node.x, node.y, node.z - 1, chunk);
 			}
 		}
@@ -162,7 +162,7 @@ void LightEngine::lampLighting()
 			{
 				chunk->getZMinus()->setState(UPDATE);
 				chunk->getZMinus()->setTorchLight(node.x, node.y, CHUNK_Z-1, lightLevel - 1);
-				if (!chunk->getZMinus()->getBlock(node.x, node.y, CHUNK_Z-1)->isActive())
+				if (!chunk->getZMinus()->getBlock(node.x, node.y, CHUNK_Z-1)->isOpaque())
 					lightBfsQueue.emplace(node.x, node.y, CHUNK_Z-1, chunk->getZMinus());
 			}
 		}
@@ -172,7 +172,7 @@ void LightEngine::lampLighting()
 			if (chunk->getTorchLight(node.x + 1, node.y, node.z) + 2 <= lightLevel)
 			{
 				chunk->setTorchLight(node.x + 1, node.y, node.z, lightLevel - 1);
-				if (!chunk->getBlock(node.x + 1, node.y, node.z)->isActive())
+				if (!chunk->getBlock(node.x + 1, node.y, node.z)->isOpaque())
 					lightBfsQueue.emplace(node.x + 1, node.y, node.z, chunk);
 			}
 		}
@@ -182,7 +182,7 @@ void LightEngine::lampLighting()
 			{
 				chunk->getXPlus()->setState(UPDATE);
 				chunk->getXPlus()->setTorchLight(0, node.y, node.z, lightLevel - 1);
-				if (!chunk->getXPlus()->getBlock(0, node.y, node.z)->isActive())
+				if (!chunk->getXPlus()->getBlock(0, node.y, node.z)->isOpaque())
 					lightBfsQueue.emplace(0, node.y, node.z, chunk->getXPlus());
 			}
 		}
@@ -192,7 +192,7 @@ void LightEngine::lampLighting()
 			if (chunk->getTorchLight(node.x, node.y + 1, node.z) + 2 <= lightLevel)
 			{
 				chunk->setTorchLight(node.x, node.y + 1, node.z, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y + 1, node.z)->isActive())
+				if (!chunk->getBlock(node.x, node.y + 1, node.z)->isOpaque())
 					lightBfsQueue.emplace(node.x, node.y + 1, node.z, chunk);
 			}
 		}
@@ -203,7 +203,7 @@ void LightEngine::lampLighting()
 			{
 				chunk->getZPlus()->setState(UPDATE);
 				chunk->setTorchLight(node.x, node.y, node.z + 1, lightLevel - 1);
-				if (!chunk->getBlock(node.x, node.y, node.z + 1)->isActive())
+				if (!chunk->getBlock(node.x, node.y, node.z + 1)->isOpaque())
 					lightBfsQueue.emplace(node.x, node.y, node.z + 1, chunk);
 			}
 		}
@@ -212,7 +212,7 @@ void LightEngine::lampLighting()
 			if (chunk->getZPlus()->getTorchLight(node.x, node.y, 0) + 2 <= lightLevel)
 			{
 				chunk->getZPlus()->setTorchLight(node.x, node.y, 0, lightLevel - 1);
-				if (!chunk->getZPlus()->getBlock(node.x, node.y, 0)->isActive())
+				if (!chunk->getZPlus()->getBlock(node.x, node.y, 0)->isOpaque())
 					lightBfsQueue.emplace(node.x, node.y, 0, chunk->getZPlus());
 			}
 		}
@@ -225,8 +225,8 @@ void LightEngine::removedLighting()
 {
 	while(lightRemovalBfsQueue.empty() == false)
 	{
-		// Get a reference to the front node
-		LightRemovalNode &node = lightRemovalBfsQueue.front();
+		// Copy the front node, popping can free the block it lives in
+		LightRemovalNode node = lightRemovalBfsQueue.front();
 		int lightLevel = (int)node.val;
 		Chunk *chunk = node.chunk;
 		// Pop the front node off the queue.
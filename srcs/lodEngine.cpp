@@ -0,0 +1,223 @@
+#include <engine.hpp>
+#include <lodEngine.hpp>
+#include <terrain.hpp>
+
+static inline int tileOf(int c)
+{
+	return ((c >= 0 ? c : c - LOD_TILE + 1) / LOD_TILE);
+}
+
+static void pushQuad(vector<BlockVertex> &m, glm::vec3 p[4], int type, int face)
+{
+	static const int order[6] = {0, 1, 2, 2, 1, 3};
+	static const glm::vec2 corners[4] = {
+		glm::vec2(0, 1), glm::vec2(1, 1), glm::vec2(0, 0), glm::vec2(1, 0)
+	};
+	int layer = BLOCKS.layer[type][face];
+	for (int i = 0; i < 6; i++)
+	{
+		BlockVertex v;
+		v.x = p[order[i]].x;
+		v.y = p[order[i]].y;
+		v.z = p[order[i]].z;
+		v.data = packVertex(layer, corners[order[i]], face, 0, LOD_SUN_LIGHT);
+		m.push_back(v);
+	}
+}
+
+LodTile::LodTile(glm::ivec2 p, int s) : pos(p), step(s)
+{
+	this->offsetMatrix = glm::translate(glm::mat4(1.0f),
+		glm::vec3((float)(pos.x * LOD_TILE * CHUNK_X), 0.0f, (float)(pos.y * LOD_TILE * CHUNK_Z)));
+	for (int i = 0; i < LOD_TILE * LOD_TILE; i++)
+		this->chunkStart[i] = this->chunkCount[i] = 0;
+
+	glGenVertexArrays(1, &this->VAO);
+	glGenBuffers(1, &this->VBO);
+	glBindVertexArray(this->VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BlockVertex), (GLvoid*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(BlockVertex), (GLvoid*)offsetof(BlockVertex, data));
+		glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+}
+
+LodTile::~LodTile(void)
+{
+	glDeleteBuffers(1, &this->VBO);
+	glDeleteVertexArrays(1, &this->VAO);
+}
+
+void LodTile::build(Terrain *terr, int s)
+{
+	this->step = s;
+	const int n = CHUNK_X / step + 1;
+	const int skirt = step * 4;
+	vector<BlockVertex> mesh;
+	vector<int> height(n * n);
+	vector<short> type(n * n);
+
+	for (int c = 0; c < LOD_TILE * LOD_TILE; c++)
+	{
+		int lx = (c % LOD_TILE) * CHUNK_X;
+		int lz = (c / LOD_TILE) * CHUNK_Z;
+		int wx = pos.x * LOD_TILE * CHUNK_X + lx;
+		int wz = pos.y * LOD_TILE * CHUNK_Z + lz;
+		// samples on the chunk edges land on the same columns as the neighbor
+		// segment's, so segments of the same step meet without cracks
+		terr->biomeEngine->fillGrid(wx, wz, step, n, n, &type[0]);
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				int base = terr->getBase(wx + i * step, wz + j * step);
+				height[i * n + j] = max(base, WATER_LEVEL);
+				if (base < WATER_LEVEL)
+					type[i * n + j] = WATER_BLOCK;
+			}
+		}
+
+		this->chunkStart[c] = mesh.size();
+		glm::vec3 q[4];
+		for (int i = 0; i < n - 1; i++)
+		{
+			for (int j = 0; j < n - 1; j++)
+			{
+				q[0] = glm::vec3(lx + i * step, height[i * n + j], lz + j * step);
+				q[1] = glm::vec3(lx + (i + 1) * step, height[(i + 1) * n + j], lz + j * step);
+				q[2] = glm::vec3(lx + i * step, height[i * n + j + 1], lz + (j + 1) * step);
+				q[3] = glm::vec3(lx + (i + 1) * step, height[(i + 1) * n + j + 1], lz + (j + 1) * step);
+				pushQuad(mesh, q, type[i * n + j], 1);
+			}
+		}
+		// skirts hanging off the segment edges hide the cracks against segments
+		// of another step and against full detail chunks
+		for (int i = 0; i < n - 1; i++)
+		{
+			int edge[4][2] = {
+				{i * n, (i + 1) * n}, // zneg
+				{i * n + n - 1, (i + 1) * n + n - 1}, // zpos
+				{i, i + 1}, // xneg
+				{(n - 1) * n + i, (n - 1) * n + i + 1} // xpos
+			};
+			int faces[4] = {5, 3, 4, 2};
+			for (int e = 0; e < 4; e++)
+			{
+				int a = edge[e][0];
+				int b = edge[e][1];
+				glm::vec3 pa(lx + (a / n) * step, height[a], lz + (a % n) * step);
+				glm::vec3 pb(lx + (b / n) * step, height[b], lz + (b % n) * step);
+				q[0] = pa;
+				q[1] = pb;
+				q[2] = glm::vec3(pa.x, pa.y - skirt, pa.z);
+				q[3] = glm::vec3(pb.x, pb.y - skirt, pb.z);
+				pushQuad(mesh, q, type[a], faces[e]);
+			}
+		}
+		this->chunkCount[c] = mesh.size() - this->chunkStart[c];
+	}
+
+	glBindVertexArray(this->VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+		glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(BlockVertex), mesh.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
+
+void LodTile::render(Shader shader, Terrain *terr, glm::ivec2 center, int nearRadius, RenderStats &stats)
+{
+	GLint first[LOD_TILE * LOD_TILE];
+	GLsizei count[LOD_TILE * LOD_TILE];
+	int draws = 0;
+	for (int c = 0; c < LOD_TILE * LOD_TILE; c++)
+	{
+		glm::ivec2 chunk(pos.x * LOD_TILE + c % LOD_TILE, pos.y * LOD_TILE + c / LOD_TILE);
+		glm::ivec2 d = chunk - center;
+		// full detail chunk drawn in its place, once it has a mesh
+		Chunk *full = terr->getChunk(chunk);
+		if (abs(d.x) < nearRadius && abs(d.y) < nearRadius && full && full->getState() != GENERATE)
+			continue ;
+		first[draws] = this->chunkStart[c];
+		count[draws] = this->chunkCount[c];
+		stats.vertices += this->chunkCount[c];
+		draws++;
+	}
+	if (!draws)
+		return ;
+	shader.setMat4("transform", this->offsetMatrix);
+	shader.setFloat("transparency", 1.0f);
+	glBindVertexArray(this->VAO);
+	glMultiDrawArrays(GL_TRIANGLES, first, count, draws);
+	glBindVertexArray(0);
+	stats.drawCalls++;
+}
+
+LodEngine::~LodEngine(void)
+{
+	for (auto it = this->tiles.begin(); it != this->tiles.end(); it++)
+		delete it->second;
+}
+
+// 2x merging in the first rings past the full detail radius, 4x then 8x further out
+int LodEngine::stepFor(glm::ivec2 tile, glm::ivec2 ct)
+{
+	glm::ivec2 d = (tile - ct) * LOD_TILE;
+	int level = max(abs(d.x), abs(d.y)) / this->ringSize;
+	return (1 << min(3, max(1, level)));
+}
+
+void LodEngine::update(glm::ivec2 center)
+{
+	glm::ivec2 ct(tileOf(center.x), tileOf(center.y));
+	int tr = this->radius / LOD_TILE + 1;
+	if (ct != this->centerTile)
+	{
+		this->centerTile = ct;
+		this->complete = false;
+		for (auto it = this->tiles.begin(); it != this->tiles.end();)
+		{
+			glm::ivec2 d = it->first - ct;
+			if (abs(d.x) > tr || abs(d.y) > tr)
+			{
+				delete it->second;
+				it = this->tiles.erase(it);
+			}
+			else
+				it++;
+		}
+	}
+	if (this->complete)
+		return ;
+
+	// nearest rings first
+	int built = 0;
+	for (int r = 0; r <= tr; r++)
+	{
+		for (int i = -r; i <= r; i++)
+		{
+			for (int j = -r; j <= r; j++)
+			{
+				if (abs(i) != r && abs(j) != r)
+					continue ;
+				glm::ivec2 tile(ct.x + i, ct.y + j);
+				int step = this->stepFor(tile, ct);
+				LodTile *t = this->tiles.count(tile) ? this->tiles[tile] : NULL;
+				if (t && t->getStep() == step)
+					continue ;
+				if (built == LOD_TILES_PER_LOOP)
+					return ;
+				if (!t)
+					this->tiles[tile] = t = new LodTile(tile, step);
+				t->build(this->terr, step);
+				built++;
+			}
+		}
+	}
+	this->complete = true;
+}
+
+void LodEngine::render(Shader shader, glm::ivec2 center, int nearRadius, RenderStats &stats)
+{
+	for (auto it = this->tiles.begin(); it != this->tiles.end(); it++)
+		it->second->render(shader, this->terr, center, nearRadius, stats);
+}
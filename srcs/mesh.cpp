@@ -2,17 +2,28 @@
 #include <shader.hpp>
 #include <mesh.hpp>
 
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+Mesh::Mesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<Texture> &textures)
 {
 	this->vertices = vertices;
 	this->indices = indices;
 	this->textures = textures;
 
-	setupMesh();
+	setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
 }
 
-void Mesh::setupMesh()
+// uploads from memory the caller owns (a mapped cooked model), nothing is kept on the cpu side
+Mesh::Mesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount, const vector<Texture> &textures)
 {
+	this->textures = textures;
+
+	setupMesh(vertices, vertexCount, indices, indexCount);
+}
+
+void Mesh::setupMesh(const Vertex *vertices, unsigned int vertexCount, const unsigned int *indices, unsigned int indexCount)
+{
+	if (!vertexCount || !indexCount)
+		return ;
+	this->indexCount = indexCount;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
@@ -20,58 +31,100 @@ void Mesh::setupMesh()
 	glBindVertexArray(VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);  
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), 
-				 &indices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), 
+				 indices, GL_STATIC_DRAW);
 
 	// vertex positions
 	glEnableVertexAttribArray(0);	
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 	// vertex normals
 	glEnableVertexAttribArray(1);	
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)sizeof(Vertex));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
 	// vertex texture coords
 	glEnableVertexAttribArray(2);	
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords)); // can switch offsetof?
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
 
 	glBindVertexArray(0);
 }
 
-void Mesh::Draw(Shader shader) 
+// per instance model matrix from the model's shared buffer. a mat4 attribute
+// takes the four vec4 slots 3 to 6, advanced once per instance
+void Mesh::setupInstances(unsigned int instanceVBO)
+{
+	if (!this->VAO)
+		return ;
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
+	glBindVertexArray(0);
+}
+
+void Mesh::bindTextures(Shader &shader)
 {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
+	if (this->samplerProgram != shader.ID)
+	{
+		// retrieve texture number (the N in diffuse_textureN)
+		unsigned int diffuseNr  = 1;
+		unsigned int specularNr = 1;
+		unsigned int normalNr   = 1;
+		unsigned int heightNr   = 1;
+		this->samplerLocations.clear();
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			string number;
+			string name = textures[i].type;
+			if (name == "texture_diffuse")
 				number = std::to_string(diffuseNr++);
-			else if(name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-             else if(name == "texture_height")
-			    number = std::to_string(heightNr++); // transfer unsigned int to stream
+			else if (name == "texture_specular")
+				number = std::to_string(specularNr++);
+			else if (name == "texture_normal")
+				number = std::to_string(normalNr++);
+			else if (name == "texture_height")
+				number = std::to_string(heightNr++);
+			this->samplerLocations.push_back(glGetUniformLocation(shader.ID, ("material." + name + number).c_str()));
+		}
+		this->samplerProgram = shader.ID;
+	}
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+		// now set the sampler to the correct texture unit
+		glUniform1i(this->samplerLocations[i], i);
+		// and finally bind the texture
+		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+	}
+}
 
-			// now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, ("material." + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+void Mesh::Draw(Shader shader)
+{
+	if (!this->indexCount)
+		return ;
+	this->bindTextures(shader);
+	// draw mesh
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+	glBindVertexArray(0);
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+	// always good practice to set everything back to defaults once configured.
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// textures are bound once for all the copies, setupInstances has to have run
+void Mesh::DrawInstanced(Shader shader, int count)
+{
+	if (!this->indexCount)
+		return ;
+	this->bindTextures(shader);
+	glBindVertexArray(VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, count);
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
 }
\ No newline at end of file
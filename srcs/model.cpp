@@ -1,6 +1,42 @@
 #include <engine.hpp>
 #include <model.hpp>
 // put includes in model.hpp because declarations needed them
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// cooked model file, written next to the source the first time it's imported:
+// header, mesh table, texture table, then the vertex and index blobs the mesh
+// table points into. a source of another size or time makes it stale
+#define COOKED_MAGIC 0x314c444d // "MDL1"
+#define COOKED_PATH 120
+
+struct CookedHeader
+{
+	uint32_t magic;
+	uint32_t meshCount;
+	uint32_t textureCount;
+	uint32_t vertexSize; // sizeof(Vertex) when it was written
+	int64_t sourceSize;
+	int64_t sourceTime;
+};
+
+struct CookedMesh
+{
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t firstTexture;
+	uint32_t textureCount;
+};
+
+struct CookedTexture
+{
+	char type[32];
+	char path[COOKED_PATH];
+};
 
 void Model::Draw(Shader shader)
 {
@@ -10,8 +46,31 @@ void Model::Draw(Shader shader)
 	}
 }
 
+// one draw call per mesh for all the transforms, with the matrices streamed
+// into the instance buffer. needs a shader taking the model matrix as the
+// mat4 attribute at location 3 (model_instanced.vs)
+void Model::DrawInstanced(Shader shader, const vector<glm::mat4> &transforms)
+{
+	if (transforms.empty())
+		return ;
+	if (!this->instanceVBO)
+	{
+		glGenBuffers(1, &this->instanceVBO);
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			meshes[i].setupInstances(this->instanceVBO);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, transforms.size() * sizeof(glm::mat4), &transforms[0], GL_STREAM_DRAW);
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		meshes[i].DrawInstanced(shader, transforms.size());
+}
+
 void Model::loadModel(string path)
 {
+	directory = path.substr(0, path.find_last_of('/'));
+	if (this->loadCooked(path + ".cooked", path))
+		return ;
+
 	Assimp::Importer import;
 	const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 	
@@ -20,9 +79,132 @@ void Model::loadModel(string path)
 		cout << "ERROR::ASSIMP::" << import.GetErrorString() << endl;
 		return;
 	}
-	directory = path.substr(0, path.find_last_of('/'));
 
+	// every texture the materials use decodes side by side before the meshes ask for them
+	vector<string> paths;
+	aiTextureType types[4] = {aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT};
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+		for (int t = 0; t < 4; t++)
+			for (unsigned int j = 0; j < scene->mMaterials[i]->GetTextureCount(types[t]); j++)
+			{
+				aiString str;
+				scene->mMaterials[i]->GetTexture(types[t], j, &str);
+				paths.push_back(directory + '/' + str.C_Str());
+			}
+	this->textureEngine.preload(paths);
 	processNode(scene->mRootNode, scene);
+	this->cook(path + ".cooked", path);
+}
+
+// maps the cooked file and hands its blobs straight to the gpu, false when it's
+// missing, stale or doesn't add up (the caller imports the source instead)
+bool Model::loadCooked(string cooked, string source)
+{
+	struct stat src, st;
+	int fd = open(cooked.c_str(), O_RDONLY);
+	if (fd < 0)
+		return (false);
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(CookedHeader))
+	{
+		close(fd);
+		return (false);
+	}
+	size_t size = st.st_size;
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (false);
+
+	const char *base = (const char *)map;
+	const CookedHeader *header = (const CookedHeader *)base;
+	const CookedMesh *table = (const CookedMesh *)(header + 1);
+	const CookedTexture *textures = (const CookedTexture *)(table + header->meshCount);
+	bool valid = header->magic == COOKED_MAGIC && header->vertexSize == sizeof(Vertex)
+		&& sizeof(CookedHeader) + (size_t)header->meshCount * sizeof(CookedMesh) + (size_t)header->textureCount * sizeof(CookedTexture) <= size;
+	// a cooked model can ship without its source
+	if (valid && stat(source.c_str(), &src) == 0)
+		valid = header->sourceSize == (int64_t)src.st_size && header->sourceTime == (int64_t)src.st_mtime;
+	for (unsigned int i = 0; valid && i < header->meshCount; i++)
+	{
+		const CookedMesh &m = table[i];
+		valid = m.vertexOffset + (uint64_t)m.vertexCount * sizeof(Vertex) <= size
+			&& m.indexOffset + (uint64_t)m.indexCount * sizeof(unsigned int) <= size
+			&& (uint64_t)m.firstTexture + m.textureCount <= header->textureCount;
+	}
+	vector<string> paths;
+	for (unsigned int i = 0; valid && i < header->textureCount; i++)
+		paths.push_back(directory + '/' + string(textures[i].path, strnlen(textures[i].path, COOKED_PATH)));
+	this->textureEngine.preload(paths);
+	for (unsigned int i = 0; valid && i < header->meshCount; i++)
+	{
+		const CookedMesh &m = table[i];
+		vector<Texture> meshTextures;
+		for (unsigned int j = 0; j < m.textureCount; j++)
+		{
+			const CookedTexture &t = textures[m.firstTexture + j];
+			meshTextures.push_back(this->loadTexture(string(t.path, strnlen(t.path, COOKED_PATH)), string(t.type, strnlen(t.type, 32))));
+		}
+		meshes.push_back(Mesh((const Vertex *)(base + m.vertexOffset), m.vertexCount,
+			(const unsigned int *)(base + m.indexOffset), m.indexCount, meshTextures));
+	}
+	munmap(map, size);
+	return (valid);
+}
+
+// written to a temporary file first so a half written one is never picked up
+void Model::cook(string cooked, string source)
+{
+	struct stat src;
+	if (stat(source.c_str(), &src) < 0)
+		return ;
+	CookedHeader header = {COOKED_MAGIC, (uint32_t)meshes.size(), 0, sizeof(Vertex), (int64_t)src.st_size, (int64_t)src.st_mtime};
+	vector<CookedMesh> table;
+	vector<CookedTexture> textures;
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		CookedMesh m = {0, 0, (uint32_t)meshes[i].vertices.size(), (uint32_t)meshes[i].indices.size(), (uint32_t)textures.size(), (uint32_t)meshes[i].textures.size()};
+		for (unsigned int j = 0; j < meshes[i].textures.size(); j++)
+		{
+			const Texture &t = meshes[i].textures[j];
+			CookedTexture c;
+			memset(&c, 0, sizeof(c));
+			if (t.path.size() > COOKED_PATH || t.type.size() > sizeof(c.type))
+			{
+				cout << "not cooking " << source << ": texture " << t.path << " (" << t.type << ") is longer than the "
+					<< COOKED_PATH << " byte path or " << sizeof(c.type) << " byte type a cooked model holds" << endl;
+				return ;
+			}
+			memcpy(c.path, t.path.data(), t.path.size());
+			memcpy(c.type, t.type.data(), t.type.size());
+			textures.push_back(c);
+		}
+		table.push_back(m);
+	}
+	header.textureCount = textures.size();
+	uint64_t offset = sizeof(header) + table.size() * sizeof(CookedMesh) + textures.size() * sizeof(CookedTexture);
+	for (unsigned int i = 0; i < table.size(); i++)
+	{
+		table[i].vertexOffset = offset;
+		offset += table[i].vertexCount * sizeof(Vertex);
+		table[i].indexOffset = offset;
+		offset += table[i].indexCount * sizeof(unsigned int);
+	}
+
+	string tmp = cooked + ".tmp";
+	ofstream out(tmp.c_str(), ios::binary);
+	out.write((const char *)&header, sizeof(header));
+	if (!table.empty())
+		out.write((const char *)&table[0], table.size() * sizeof(CookedMesh));
+	if (!textures.empty())
+		out.write((const char *)&textures[0], textures.size() * sizeof(CookedTexture));
+	for (unsigned int i = 0; i < meshes.size(); i++)
+	{
+		out.write((const char *)meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+		out.write((const char *)meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+	}
+	out.close();
+	if (!out || rename(tmp.c_str(), cooked.c_str()) < 0)
+		unlink(tmp.c_str());
 }
 
 void Model::processNode(aiNode *node, const aiScene *scene)
@@ -113,26 +295,21 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type,
 	{
 		aiString str;
 		mat->GetTexture(type, i, &str);
-		// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-		bool skip = false;
-		for(unsigned int j = 0; j < textures_loaded.size(); j++)
-		{
-			if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-			{
-				textures.push_back(textures_loaded[j]);
-				skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-				break;
-			}
-		}
-		if(!skip)
-		{   // if texture hasn't been loaded already, load it
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), this->directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
-			textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-		}
+		textures.push_back(this->loadTexture(str.C_Str(), typeName));
 	}
 	return textures;
+}
+
+// check if texture was loaded before and if so skip loading a new texture
+Texture Model::loadTexture(string path, string typeName)
+{
+	for (unsigned int j = 0; j < textures_loaded.size(); j++)
+		if (textures_loaded[j].path == path)
+			return (textures_loaded[j]);
+	Texture texture;
+	texture.id = this->textureEngine.TextureFromFile(path.c_str(), this->directory);
+	texture.type = typeName;
+	texture.path = path;
+	textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+	return (texture);
 }
\ No newline at end of file
@@ -0,0 +1,724 @@
+#include <engine.hpp>
+#include <networkEngine.hpp>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifndef MSG_NOSIGNAL // macos, SO_NOSIGPIPE is set on the socket instead
+# define MSG_NOSIGNAL 0
+#endif
+
+static void setupSocket(int fd)
+{
+	int one = 1;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // edits are tiny, don't hold them back
+#ifdef SO_NOSIGPIPE
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+
+void encodeChunk(Chunk *c, vector<uint8_t> &out)
+{
+	for (int s = 0; s < SECTIONS; s++)
+	{
+		uint16_t index[BLOCK_TYPES];
+		uint8_t palette[BLOCK_TYPES];
+		int count = 0;
+		memset(index, 0xff, sizeof(index));
+		for (int x = 0; x < CHUNK_X; x++)
+			for (int y = s * SECTION_Y; y < (s + 1) * SECTION_Y; y++)
+				for (int z = 0; z < CHUNK_Z; z++)
+				{
+					uint8_t type = c->getBlock(x, y, z)->getType();
+					if (index[type] == 0xffff)
+					{
+						index[type] = count;
+						palette[count++] = type;
+					}
+				}
+		int bits = 0;
+		while ((1 << bits) < count)
+			bits++;
+		out.push_back(count - 1);
+		out.insert(out.end(), palette, palette + count);
+		uint64_t word = 0;
+		int filled = 0;
+		for (int x = 0; x < CHUNK_X && bits; x++)
+			for (int y = s * SECTION_Y; y < (s + 1) * SECTION_Y; y++)
+				for (int z = 0; z < CHUNK_Z; z++)
+				{
+					word |= (uint64_t)index[c->getBlock(x, y, z)->getType()] << filled;
+					if ((filled += bits) >= 8)
+					{
+						out.push_back(word & 0xff);
+						word >>= 8;
+						filled -= 8;
+					}
+				}
+		if (filled)
+			out.push_back(word & 0xff);
+	}
+}
+
+bool decodeChunk(const uint8_t *data, size_t size, Chunk *c)
+{
+	const uint8_t *end = data + size;
+	for (int s = 0; s < SECTIONS; s++)
+	{
+		if (data >= end)
+			return (false);
+		int count = *data++ + 1;
+		if (end - data < count)
+			return (false);
+		const uint8_t *palette = data;
+		data += count;
+		int bits = 0;
+		while ((1 << bits) < count)
+			bits++;
+		if (end - data < (CHUNK_X * SECTION_Y * CHUNK_Z * bits + 7) / 8)
+			return (false);
+		uint64_t word = 0;
+		int filled = 0;
+		for (int x = 0; x < CHUNK_X; x++)
+			for (int y = s * SECTION_Y; y < (s + 1) * SECTION_Y; y++)
+				for (int z = 0; z < CHUNK_Z; z++)
+				{
+					while (filled < bits)
+					{
+						word |= (uint64_t)*data++ << filled;
+						filled += 8;
+					}
+					int i = word & ((1 << bits) - 1);
+					word >>= bits;
+					filled -= bits;
+					if (i >= count)
+						return (false);
+					c->getBlock(x, y, z)->setType(palette[i]);
+				}
+	}
+	return (data == end);
+}
+
+Connection::~Connection()
+{
+	if (this->fd >= 0)
+		close(this->fd);
+}
+
+void Connection::send(uint8_t type, const void *payload, uint32_t size)
+{
+	const uint8_t *header = (const uint8_t *)&size;
+	this->out.insert(this->out.end(), header, header + sizeof(size));
+	this->out.push_back(type);
+	this->out.insert(this->out.end(), (const uint8_t *)payload, (const uint8_t *)payload + size);
+}
+
+// sent and not yet acknowledged by the peer
+static size_t kernelQueued(int fd)
+{
+	int queued = 0;
+#ifdef SO_NWRITE
+	socklen_t size = sizeof(queued);
+	getsockopt(fd, SOL_SOCKET, SO_NWRITE, &queued, &size);
+#else
+	ioctl(fd, TIOCOUTQ, &queued);
+#endif
+	return (max(queued, 0));
+}
+
+bool Connection::flush()
+{
+	while (this->sent < this->out.size())
+	{
+		ssize_t n = ::send(this->fd, &this->out[this->sent], this->out.size() - this->sent, MSG_NOSIGNAL);
+		if (n > 0)
+			this->sent += n;
+		else if (n < 0 && errno == EINTR)
+			continue ;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			this->queued = kernelQueued(this->fd);
+			return (true);
+		}
+		else
+			return (false);
+	}
+	this->out.clear();
+	this->sent = 0;
+	this->queued = kernelQueued(this->fd);
+	return (true);
+}
+
+bool Connection::receive()
+{
+	// drop what was already handed out before appending
+	if (this->read)
+	{
+		this->in.erase(this->in.begin(), this->in.begin() + this->read);
+		this->read = 0;
+	}
+	uint8_t buffer[1 << 16];
+	for (;;)
+	{
+		ssize_t n = recv(this->fd, buffer, sizeof(buffer), 0);
+		if (n > 0)
+			this->in.insert(this->in.end(), buffer, buffer + n);
+		else if (n < 0 && errno == EINTR)
+			continue ;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return (true);
+		else
+			return (false);
+	}
+}
+
+bool Connection::next(uint8_t &type, vector<uint8_t> &payload)
+{
+	uint32_t size;
+	if (this->in.size() - this->read < sizeof(size) + 1)
+		return (false);
+	memcpy(&size, &this->in[this->read], sizeof(size));
+	if (size > MESSAGE_LIMIT)
+	{
+		this->valid = false;
+		return (false);
+	}
+	if (this->in.size() - this->read < sizeof(size) + 1 + size)
+		return (false);
+	type = this->in[this->read + sizeof(size)];
+	const uint8_t *start = &this->in[this->read + sizeof(size) + 1];
+	payload.assign(start, start + size);
+	this->read += sizeof(size) + 1 + size;
+	return (true);
+}
+
+ServerEngine::ServerEngine(Terrain *t, int port) : terr(t)
+{
+	int one = 1;
+	struct sockaddr_in addr;
+	socklen_t length = sizeof(addr);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if ((this->listener = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+		return ;
+	setsockopt(this->listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(this->listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(this->listener, 64) < 0
+		|| getsockname(this->listener, (struct sockaddr *)&addr, &length) < 0)
+	{
+		close(this->listener);
+		this->listener = -1;
+		return ;
+	}
+	fcntl(this->listener, F_SETFL, fcntl(this->listener, F_GETFL) | O_NONBLOCK);
+	this->port = ntohs(addr.sin_port);
+}
+
+ServerEngine::~ServerEngine()
+{
+	for (size_t i = 0; i < this->clients.size(); i++)
+		delete this->clients[i];
+	if (this->listener >= 0)
+		close(this->listener);
+}
+
+void ServerEngine::generate(glm::ivec2 pos)
+{
+	if (this->terr->getChunk(pos))
+		return ;
+	this->terr->addChunk(pos)->setTerrain();
+}
+
+// generates pos and its 8 neighbors and hands out the blocks their structures spilled,
+// after that only edits change pos. nothing further away reaches into it
+Chunk *ServerEngine::prepareChunk(glm::ivec2 pos)
+{
+	if (this->complete.count(pos))
+		return (this->terr->getChunk(pos));
+	for (int i = -1; i <= 1; i++)
+		for (int j = -1; j <= 1; j++)
+			this->generate(pos + glm::ivec2(i, j));
+	for (int i = -1; i <= 1; i++)
+		for (int j = -1; j <= 1; j++)
+			this->terr->setNeighbors(pos + glm::ivec2(i, j));
+	// a diagonal neighbor's blocks get to pos through the queue of a side neighbor
+	for (int i = -1; i <= 1; i += 2)
+		for (int j = -1; j <= 1; j += 2)
+			this->terr->getChunk(pos + glm::ivec2(i, j))->neighborQueueUnload();
+	const glm::ivec2 sides[4] = {glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1)};
+	for (int i = 0; i < 4; i++)
+		this->terr->getChunk(pos + sides[i])->neighborQueueUnload();
+	// generated again after a sweep, the edits go back on top of the seed's blocks
+	auto journal = this->journals.find(pos);
+	if (journal != this->journals.end())
+		for (auto it = journal->second.blocks.begin(); it != journal->second.blocks.end(); it++)
+			this->terr->setBlock(glm::ivec3(pos.x * CHUNK_X + (it->first >> 12), it->first & 0xff,
+				pos.y * CHUNK_Z + ((it->first >> 8) & 0xf)), it->second, false);
+	this->complete.insert(pos);
+	return (this->terr->getChunk(pos));
+}
+
+// hands back the chunks no client holds or is about to, UNLOAD_MARGIN past every view.
+// a complete chunk that stays keeps its 8 neighbors, one generated again next to it
+// would spill its structures over the edits. the journals stay for when they come back
+void ServerEngine::sweep()
+{
+	unordered_set<glm::ivec2> keep;
+	for (auto it = this->complete.begin(); it != this->complete.end();)
+	{
+		bool near = false;
+		for (size_t i = 0; i < this->clients.size() && !near; i++)
+		{
+			glm::ivec2 d = *it - this->clients[i]->center;
+			near = max(abs(d.x), abs(d.y)) <= this->clients[i]->radius + UNLOAD_MARGIN;
+		}
+		if (!near)
+		{
+			it = this->complete.erase(it);
+			continue ;
+		}
+		for (int i = -1; i <= 1; i++)
+			for (int j = -1; j <= 1; j++)
+				keep.insert(*it + glm::ivec2(i, j));
+		it++;
+	}
+	vector<glm::ivec2> far;
+	for (auto it = this->terr->world.begin(); it != this->terr->world.end(); it++)
+		if (!keep.count(it->first))
+			far.push_back(it->first);
+	for (size_t i = 0; i < far.size(); i++)
+		this->terr->unloadChunk(far[i]);
+	this->chunksUnloaded += far.size();
+}
+
+void ServerEngine::sendChunk(ClientState *client, glm::ivec2 pos)
+{
+	Chunk *c = this->prepareChunk(pos);
+	auto journal = this->journals.find(pos);
+	uint32_t sequence = (journal != this->journals.end()) ? journal->second.sequence : 0;
+	// edits still pending are in the blocks already, their batch sets them again
+	vector<uint8_t> payload(sizeof(pos) + sizeof(sequence));
+	memcpy(&payload[0], &pos, sizeof(pos));
+	memcpy(&payload[sizeof(pos)], &sequence, sizeof(sequence));
+	encodeChunk(c, payload);
+	client->connection.send(CHUNK_MESSAGE, &payload[0], payload.size());
+	client->sent[pos] = sequence;
+	this->chunksSent++;
+	this->chunkBytes += payload.size();
+}
+
+void ServerEngine::sendBatch(ClientState *client, glm::ivec2 pos, uint32_t sequence, const vector<uint8_t> &batch)
+{
+	vector<uint8_t> payload(sizeof(pos) + sizeof(sequence));
+	memcpy(&payload[0], &pos, sizeof(pos));
+	memcpy(&payload[sizeof(pos)], &sequence, sizeof(sequence));
+	payload.insert(payload.end(), batch.begin(), batch.end());
+	client->connection.send(DELTA_MESSAGE, &payload[0], payload.size());
+	client->sent[pos] = sequence;
+	this->batchesSent++;
+	this->batchBytes += payload.size();
+}
+
+// first whatever was held back, from the journal while it still reaches back far
+// enough, then new chunks
+void ServerEngine::stream(ClientState *client)
+{
+	for (auto it = client->behind.begin(); it != client->behind.end() && client->connection.backlog() < SEND_LIMIT;)
+	{
+		glm::ivec2 pos = *it;
+		it = client->behind.erase(it);
+		ChunkJournal &journal = this->journals[pos];
+		uint32_t held = client->sent[pos];
+		if (journal.sequence - held <= journal.history.size())
+			for (uint32_t s = held + 1; s <= journal.sequence; s++)
+			{
+				this->sendBatch(client, pos, s, journal.history[journal.history.size() - 1 - (journal.sequence - s)]);
+				this->batchesReplayed++;
+			}
+		else
+		{
+			this->sendChunk(client, pos);
+			this->chunksResent++;
+		}
+	}
+	for (int n = 0; n < CHUNKS_PER_STREAM && client->connection.backlog() < SEND_LIMIT && !client->queue.empty();)
+	{
+		glm::ivec2 pos = client->queue.back();
+		client->queue.pop_back();
+		if (client->sent.count(pos))
+			continue ;
+		this->sendChunk(client, pos);
+		n++;
+	}
+}
+
+// end of the tick: every dirty journal flushes its deltas as one batch to the clients
+// holding the chunk, a client with a full connection gets it later in stream()
+void ServerEngine::broadcast()
+{
+	for (size_t i = 0; i < this->dirty.size(); i++)
+	{
+		glm::ivec2 pos = this->dirty[i];
+		ChunkJournal &journal = this->journals[pos];
+		vector<uint8_t> batch;
+		batch.reserve(journal.pending.size() * DELTA_SIZE);
+		for (auto it = journal.pending.begin(); it != journal.pending.end(); it++)
+		{
+			batch.push_back(it->first >> 8);
+			batch.push_back(it->first & 0xff);
+			batch.push_back(it->second);
+		}
+		journal.pending.clear();
+		journal.sequence++;
+		journal.history.push_back(batch);
+		if (journal.history.size() > JOURNAL_LENGTH)
+			journal.history.pop_front();
+		for (size_t j = 0; j < this->clients.size(); j++)
+		{
+			ClientState *client = this->clients[j];
+			if (!client->sent.count(pos))
+				continue ;
+			if (client->behind.count(pos) || client->connection.backlog() >= SEND_LIMIT)
+				client->behind.insert(pos);
+			else
+				this->sendBatch(client, pos, journal.sequence, batch);
+		}
+	}
+	this->dirty.clear();
+	// after the batches, so a client sees its edit before the ack unless it is behind
+	for (size_t i = 0; i < this->clients.size(); i++)
+		if (this->clients[i]->ack)
+		{
+			this->clients[i]->connection.send(ACK_MESSAGE, &this->clients[i]->lastEdit, sizeof(uint32_t));
+			this->clients[i]->ack = false;
+		}
+}
+
+void ServerEngine::handle(ClientState *client, uint8_t type, const vector<uint8_t> &payload)
+{
+	if (type == VIEW_MESSAGE && payload.size() == sizeof(glm::ivec2) + sizeof(int))
+	{
+		memcpy(&client->center, &payload[0], sizeof(glm::ivec2));
+		memcpy(&client->radius, &payload[sizeof(glm::ivec2)], sizeof(int));
+		client->radius = min(max(client->radius, 0), RENDER_RADIUS);
+		// chunks a ring past the view leave the interest set, coming back means a fresh copy
+		for (auto it = client->sent.begin(); it != client->sent.end();)
+		{
+			glm::ivec2 d = it->first - client->center;
+			if (max(abs(d.x), abs(d.y)) > client->radius)
+			{
+				client->behind.erase(it->first);
+				it = client->sent.erase(it);
+			}
+			else
+				it++;
+		}
+		// the same square the client renders, farthest first so the nearest pops off the back
+		client->queue.clear();
+		for (int i = -client->radius + 1; i < client->radius; i++)
+			for (int j = -client->radius + 1; j < client->radius; j++)
+				if (!client->sent.count(client->center + glm::ivec2(i, j)))
+					client->queue.push_back(client->center + glm::ivec2(i, j));
+		glm::ivec2 center = client->center;
+		sort(client->queue.begin(), client->queue.end(), [center](const glm::ivec2 &a, const glm::ivec2 &b) {
+			glm::ivec2 da = a - center, db = b - center;
+			return (da.x * da.x + da.y * da.y > db.x * db.x + db.y * db.y);
+		});
+	}
+	else if (type == EDIT_MESSAGE && payload.size() == sizeof(glm::ivec3) + 1 + sizeof(uint32_t))
+	{
+		glm::ivec3 pos;
+		memcpy(&pos, &payload[0], sizeof(pos));
+		memcpy(&client->lastEdit, &payload[sizeof(pos) + 1], sizeof(uint32_t));
+		client->ack = true;
+		uint8_t block = payload[sizeof(pos)];
+		glm::ivec2 chunk(floorDiv(pos.x, CHUNK_X), floorDiv(pos.z, CHUNK_Z));
+		// only what the client holds can be edited, and only into a block type there is
+		if (pos.y < 0 || pos.y >= CHUNK_Y || !client->sent.count(chunk) || !BLOCKS.known[block])
+			return ;
+		// torch light and the edited flag like a local edit. nothing draws the server's
+		// world, the clients remesh the chunk and its neighbors when the batch comes in
+		if (!this->terr->setBlock(pos, block, false))
+			return ;
+		glm::ivec3 local(pos.x - chunk.x * CHUNK_X, pos.y, pos.z - chunk.y * CHUNK_Z);
+		ChunkJournal &journal = this->journals[chunk];
+		if (journal.pending.empty())
+			this->dirty.push_back(chunk);
+		journal.pending[(local.x << 12) | (local.z << 8) | local.y] = block;
+		journal.blocks[(local.x << 12) | (local.z << 8) | local.y] = block;
+		this->editsApplied++;
+		for (size_t i = 0; i < this->clients.size(); i++)
+			this->editsInterested += this->clients[i]->sent.count(chunk);
+	}
+}
+
+void ServerEngine::update(int timeout)
+{
+	if (this->listener < 0)
+		return ;
+	vector<struct pollfd> fds(1 + this->clients.size());
+	fds[0].fd = this->listener;
+	fds[0].events = POLLIN;
+	for (size_t i = 0; i < this->clients.size(); i++)
+	{
+		ClientState *client = this->clients[i];
+		fds[i + 1].fd = client->connection.fd;
+		fds[i + 1].events = POLLIN | (client->connection.pending() ? POLLOUT : 0);
+		// chunks or batches left to stream, don't sleep
+		if ((!client->queue.empty() || !client->behind.empty()) && client->connection.backlog() < SEND_LIMIT)
+			timeout = 0;
+	}
+	if (poll(&fds[0], fds.size(), timeout) < 0)
+		return ;
+
+	// every client's messages first, so the edits of this tick go out as one batch per chunk
+	vector<uint8_t> payload;
+	uint8_t type;
+	vector<bool> open(this->clients.size(), true);
+	for (size_t i = 0; i < this->clients.size(); i++)
+	{
+		ClientState *client = this->clients[i];
+		if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+			open[i] = client->connection.receive();
+		while (open[i] && client->connection.next(type, payload))
+			this->handle(client, type, payload);
+	}
+	this->broadcast();
+
+	vector<ClientState *> alive;
+	for (size_t i = 0; i < this->clients.size(); i++)
+	{
+		ClientState *client = this->clients[i];
+		if (open[i] && client->connection.valid)
+		{
+			this->stream(client);
+			open[i] = client->connection.flush();
+		}
+		if (open[i] && client->connection.valid)
+			alive.push_back(client);
+		else
+			delete client;
+	}
+	this->clients = alive;
+	if (++this->ticks % SWEEP_TICKS == 0)
+		this->sweep();
+
+	if (fds[0].revents & POLLIN)
+	{
+		int fd;
+		while ((fd = accept(this->listener, NULL, NULL)) >= 0)
+		{
+			setupSocket(fd);
+			this->clients.push_back(new ClientState(fd));
+			int seed = this->terr->getSeed();
+			this->clients.back()->connection.send(SEED_MESSAGE, &seed, sizeof(seed));
+		}
+	}
+}
+
+ClientEngine::~ClientEngine()
+{
+	delete this->connection;
+	delete this->scratch;
+}
+
+bool ClientEngine::connect(const string &host, int port)
+{
+	struct addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &res))
+		return (false);
+	int fd = -1;
+	for (struct addrinfo *a = res; a && fd < 0; a = a->ai_next)
+	{
+		if ((fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol)) < 0)
+			continue ;
+		if (::connect(fd, a->ai_addr, a->ai_addrlen) < 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+	if (fd < 0)
+		return (false);
+	setupSocket(fd);
+	delete this->connection;
+	this->connection = new Connection(fd);
+	this->radius = -1;
+	return (true);
+}
+
+void ClientEngine::setView(glm::ivec2 center, int radius)
+{
+	if (!this->connection || (center == this->center && radius == this->radius))
+		return ;
+	this->center = center;
+	this->radius = radius;
+	uint8_t payload[sizeof(glm::ivec2) + sizeof(int)];
+	memcpy(payload, &center, sizeof(center));
+	memcpy(payload + sizeof(center), &radius, sizeof(radius));
+	this->connection->send(VIEW_MESSAGE, payload, sizeof(payload));
+}
+
+// asks the server for the edit, the terrain only changes once it comes back
+uint32_t ClientEngine::sendEdit(glm::ivec3 pos, uint8_t type)
+{
+	if (!this->connection)
+		return (0);
+	uint32_t id = this->nextEdit++;
+	uint8_t payload[sizeof(pos) + 1 + sizeof(id)];
+	memcpy(payload, &pos, sizeof(pos));
+	payload[sizeof(pos)] = type;
+	memcpy(payload + sizeof(pos) + 1, &id, sizeof(id));
+	this->connection->send(EDIT_MESSAGE, payload, sizeof(payload));
+	return (id);
+}
+
+// chunks radius or more from center go back to the pool like the local world's, edited
+// ones too: the server evicted them from the interest set already and sends a fresh copy,
+// edits included, when they come back into view
+int ClientEngine::unloadChunks(glm::ivec2 center, int radius)
+{
+	for (auto it = this->sequences.begin(); it != this->sequences.end();)
+	{
+		glm::ivec2 d = it->first - center;
+		if (max(abs(d.x), abs(d.y)) >= radius)
+			it = this->sequences.erase(it);
+		else
+			it++;
+	}
+	if (!this->terr)
+		return (0);
+	return (this->terr->unloadChunks(center, radius, false));
+}
+
+// a fresh chunk is lit and meshed like a generated one, and the neighbors that
+// meshed their border against the heightmap so far are meshed again
+void ClientEngine::addChunk(glm::ivec2 pos, uint32_t sequence, const uint8_t *data, size_t size)
+{
+	if (!this->terr)
+	{
+		if (!this->scratch)
+			this->scratch = new Chunk();
+		if (decodeChunk(data, size, this->scratch))
+		{
+			this->sequences[pos] = sequence;
+			this->chunksReceived++;
+		}
+		return ;
+	}
+	Chunk *c = this->terr->getChunk(pos);
+	bool fresh = !c;
+	if (fresh)
+		c = this->terr->chunkPool->acquire(pos.x, pos.y, this->terr);
+	if (!decodeChunk(data, size, c))
+	{
+		if (fresh)
+			this->terr->chunkPool->release(c);
+		return ;
+	}
+	this->sequences[pos] = sequence;
+	this->chunksReceived++;
+	if (!fresh)
+	{
+		this->touched.insert(pos);
+		return ;
+	}
+	this->terr->world[pos] = c;
+	this->terr->setNeighbors(pos);
+	this->terr->lightEngine->sunlightInit(c);
+	c->update();
+	this->touched.erase(pos);
+	const glm::ivec2 sides[4] = {glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1)};
+	for (int i = 0; i < 4; i++)
+		if (this->terr->getChunk(pos + sides[i]))
+		{
+			this->terr->setNeighbors(pos + sides[i]);
+			this->touched.insert(pos + sides[i]);
+		}
+}
+
+// blocks change right away, the chunk and the neighbors sharing a changed border
+// are remeshed once every message of the update is in
+void ClientEngine::applyBatch(glm::ivec2 pos, uint32_t sequence, const uint8_t *data, size_t size)
+{
+	auto held = this->sequences.find(pos);
+	if (held == this->sequences.end() || sequence != held->second + 1 || size % DELTA_SIZE)
+	{
+		this->batchesDropped++;
+		return ;
+	}
+	held->second = sequence;
+	this->batchesReceived++;
+	if (!this->terr)
+		return ;
+	for (size_t i = 0; i < size; i += DELTA_SIZE)
+	{
+		int x = data[i] >> 4;
+		int z = data[i] & 0xf;
+		this->terr->setBlock(glm::ivec3(pos.x * CHUNK_X + x, data[i + 1], pos.y * CHUNK_Z + z), data[i + 2], false);
+		if (x == 0)
+			this->touched.insert(pos + glm::ivec2(-1, 0));
+		if (x == CHUNK_X - 1)
+			this->touched.insert(pos + glm::ivec2(1, 0));
+		if (z == 0)
+			this->touched.insert(pos + glm::ivec2(0, -1));
+		if (z == CHUNK_Z - 1)
+			this->touched.insert(pos + glm::ivec2(0, 1));
+	}
+	this->touched.insert(pos);
+}
+
+bool ClientEngine::update()
+{
+	if (!this->connection || !this->connection->receive())
+		return (false);
+	vector<uint8_t> payload;
+	uint8_t type;
+	int chunks = 0;
+	const size_t header = sizeof(glm::ivec2) + sizeof(uint32_t);
+	while ((!this->terr || chunks < CHUNKS_PER_UPDATE) && this->connection->next(type, payload))
+	{
+		this->bytesReceived += payload.size();
+		glm::ivec2 pos;
+		uint32_t sequence;
+		if ((type == CHUNK_MESSAGE || type == DELTA_MESSAGE) && payload.size() >= header)
+		{
+			memcpy(&pos, &payload[0], sizeof(pos));
+			memcpy(&sequence, &payload[sizeof(pos)], sizeof(sequence));
+		}
+		if (type == CHUNK_MESSAGE && payload.size() > header)
+		{
+			this->addChunk(pos, sequence, &payload[header], payload.size() - header);
+			chunks++;
+		}
+		else if (type == DELTA_MESSAGE && payload.size() >= header)
+			this->applyBatch(pos, sequence, &payload[header], payload.size() - header);
+		else if (type == ACK_MESSAGE && payload.size() == sizeof(uint32_t))
+			memcpy(&this->lastEdit, &payload[0], sizeof(uint32_t));
+		else if (type == SEED_MESSAGE && payload.size() == sizeof(int) && !this->seeded)
+		{
+			int seed;
+			memcpy(&seed, &payload[0], sizeof(seed));
+			if (this->terr)
+				this->terr->setSeed(seed);
+			this->seeded = true;
+		}
+	}
+	for (auto it = this->touched.begin(); it != this->touched.end(); it++)
+		if (this->terr->getChunk(*it))
+			this->terr->updateChunk(*it);
+	this->touched.clear();
+	return (this->connection->valid && this->connection->flush());
+}
\ No newline at end of file
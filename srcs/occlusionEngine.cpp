@@ -0,0 +1,161 @@
+#include <engine.hpp>
+#include <occlusionEngine.hpp>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+void OcclusionEngine::clear(glm::mat4 vp)
+{
+	this->viewProjection = vp;
+	for (int i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; i++)
+		this->depth[i] = 1.0f;
+}
+
+// to buffer space: x and y in pixels, z in [0, 1]. false when behind the near plane
+bool OcclusionEngine::project(glm::vec3 p, glm::vec3 &out)
+{
+	glm::vec4 clip = this->viewProjection * glm::vec4(p, 1.0f);
+	if (clip.w < 0.1f)
+		return (false);
+	out.x = (clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+	out.y = (clip.y / clip.w * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+	out.z = clip.z / clip.w * 0.5f + 0.5f;
+	return (true);
+}
+
+void OcclusionEngine::drawOccluder(glm::vec3 mn, glm::vec3 mx)
+{
+	// wound clockwise seen from outside, so faces toward the camera have negative area on screen
+	static const int tris[36] = {
+		0, 1, 2, 2, 1, 3,  4, 6, 5, 5, 6, 7, // zneg, zpos
+		0, 2, 4, 4, 2, 6,  1, 5, 3, 3, 5, 7, // xneg, xpos
+		0, 4, 1, 1, 4, 5,  2, 3, 6, 6, 3, 7  // yneg, ypos
+	};
+	glm::vec3 p[8];
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(i & 1 ? mx.x : mn.x, i & 2 ? mx.y : mn.y, i & 4 ? mx.z : mn.z);
+		// clipping isn't worth it for occluders, just leave out ones crossing the near plane
+		if (!this->project(corner, p[i]))
+			return ;
+	}
+	for (int i = 0; i < 36; i += 3)
+	{
+		const glm::vec3 &a = p[tris[i]], &b = p[tris[i + 1]], &c = p[tris[i + 2]];
+		// back faces are covered by the front ones and always farther, skip them
+		if ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x) < 0.0f)
+			this->rasterize(a, b, c);
+	}
+}
+
+// keeps the nearest depth of every pixel whose center is inside the triangle.
+// depth is z/w, which is linear in screen space
+void OcclusionEngine::rasterize(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (fabs(area) < 1e-6f)
+		return ;
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+	int minX = max(0, (int)floor(min(v0.x, min(v1.x, v2.x))));
+	int maxX = min(OCCLUSION_WIDTH - 1, (int)ceil(max(v0.x, max(v1.x, v2.x))));
+	int minY = max(0, (int)floor(min(v0.y, min(v1.y, v2.y))));
+	int maxY = min(OCCLUSION_HEIGHT - 1, (int)ceil(max(v0.y, max(v1.y, v2.y))));
+	if (minX > maxX || minY > maxY)
+		return ;
+
+	// edge functions a * x + b * y + c, positive inside, one per edge opposite a vertex
+	const glm::vec3 *v[3] = {&v0, &v1, &v2};
+	float ea[3], eb[3], ec[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3 &p = *v[(i + 1) % 3];
+		const glm::vec3 &q = *v[(i + 2) % 3];
+		ea[i] = p.y - q.y;
+		eb[i] = q.x - p.x;
+		ec[i] = -(ea[i] * p.x + eb[i] * p.y);
+	}
+	// the edge values divided by area are the barycentrics, so they give the depth plane
+	float za = (ea[0] * v0.z + ea[1] * v1.z + ea[2] * v2.z) / area;
+	float zb = (eb[0] * v0.z + eb[1] * v1.z + eb[2] * v2.z) / area;
+	float zc = (ec[0] * v0.z + ec[1] * v1.z + ec[2] * v2.z) / area;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float fy = y + 0.5f;
+		float *row = &this->depth[y * OCCLUSION_WIDTH];
+#ifdef __SSE2__
+		const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 e0y = _mm_set1_ps(eb[0] * fy + ec[0]);
+		__m128 e1y = _mm_set1_ps(eb[1] * fy + ec[1]);
+		__m128 e2y = _mm_set1_ps(eb[2] * fy + ec[2]);
+		__m128 zy = _mm_set1_ps(zb * fy + zc);
+		for (int x = minX & ~3; x <= maxX; x += 4)
+		{
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+			__m128 in = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[0]), px), e0y), zero);
+			in = _mm_and_ps(in, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[1]), px), e1y), zero));
+			in = _mm_and_ps(in, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[2]), px), e2y), zero));
+			if (!_mm_movemask_ps(in))
+				continue ;
+			__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), zy);
+			__m128 old = _mm_load_ps(row + x);
+			__m128 nearest = _mm_min_ps(old, z);
+			_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(in, nearest), _mm_andnot_ps(in, old)));
+		}
+#else
+		for (int x = minX; x <= maxX; x++)
+		{
+			float fx = x + 0.5f;
+			if (ea[0] * fx + eb[0] * fy + ec[0] < 0.0f || ea[1] * fx + eb[1] * fy + ec[1] < 0.0f
+				|| ea[2] * fx + eb[2] * fy + ec[2] < 0.0f)
+				continue ;
+			row[x] = min(row[x], za * fx + zb * fy + zc);
+		}
+#endif
+	}
+}
+
+// true when some pixel under the box's screen rectangle is farther than the
+// box's nearest point. boxes completely off screen are not visible
+bool OcclusionEngine::isVisible(glm::vec3 mn, glm::vec3 mx)
+{
+	float minX = OCCLUSION_WIDTH, maxX = -1.0f, minY = OCCLUSION_HEIGHT, maxY = -1.0f, nearZ = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 p;
+		if (!this->project(glm::vec3(i & 1 ? mx.x : mn.x, i & 2 ? mx.y : mn.y, i & 4 ? mx.z : mn.z), p))
+			return (true);
+		minX = min(minX, p.x);
+		maxX = max(maxX, p.x);
+		minY = min(minY, p.y);
+		maxY = max(maxY, p.y);
+		nearZ = min(nearZ, p.z);
+	}
+	int x0 = max(0, (int)floor(minX));
+	int x1 = min(OCCLUSION_WIDTH - 1, (int)ceil(maxX));
+	int y0 = max(0, (int)floor(minY));
+	int y1 = min(OCCLUSION_HEIGHT - 1, (int)ceil(maxY));
+	if (x0 > x1 || y0 > y1)
+		return (false);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float *row = &this->depth[y * OCCLUSION_WIDTH];
+#ifdef __SSE2__
+		__m128 z = _mm_set1_ps(nearZ);
+		for (int x = x0 & ~3; x <= x1; x += 4)
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_load_ps(row + x), z)))
+				return (true);
+#else
+		for (int x = x0; x <= x1; x++)
+			if (row[x] >= nearZ)
+				return (true);
+#endif
+	}
+	return (false);
+}
@@ -0,0 +1,92 @@
+#include <engine.hpp>
+#include <physicsEngine.hpp>
+
+// moves the box d along one axis, stopping flush against the first solid cell
+// layer in the way. true when it was stopped. a box already overlapping blocks
+// can always move out of them, only the cells in front of it are tested
+bool PhysicsEngine::sweep(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, int axis, float d)
+{
+	if (d == 0.0f)
+		return (false);
+	glm::vec3 mn(pos.x - size.x, pos.y, pos.z - size.x);
+	glm::vec3 mx(pos.x + size.x, pos.y + size.y, pos.z + size.x);
+	// cells the box covers on the other two axes
+	int u = (axis + 1) % 3;
+	int v = (axis + 2) % 3;
+	int u0 = floor(mn[u] + PHYSICS_SKIN), u1 = floor(mx[u] - PHYSICS_SKIN);
+	int v0 = floor(mn[v] + PHYSICS_SKIN), v1 = floor(mx[v] - PHYSICS_SKIN);
+
+	float lead = (d > 0.0f) ? mx[axis] : mn[axis];
+	int step = (d > 0.0f) ? 1 : -1;
+	int first = (d > 0.0f) ? (int)floor(lead - PHYSICS_SKIN) + 1 : (int)floor(lead + PHYSICS_SKIN) - 1;
+	int last = (d > 0.0f) ? (int)floor(lead + d - PHYSICS_SKIN) : (int)floor(lead + d + PHYSICS_SKIN);
+	glm::ivec3 cell;
+	for (int c = first; c != last + step; c += step)
+	{
+		cell[axis] = c;
+		for (cell[u] = u0; cell[u] <= u1; cell[u]++)
+		{
+			for (cell[v] = v0; cell[v] <= v1; cell[v]++)
+			{
+				if (!this->isSolid(blocks, cell))
+					continue ;
+				// flush against the layer, never backwards if the box already pokes into it
+				float border = (d > 0.0f) ? (float)c : (float)(c + 1);
+				pos[axis] += (d > 0.0f) ? max(0.0f, border - lead) : min(0.0f, border - lead);
+				return (true);
+			}
+		}
+	}
+	pos[axis] += d;
+	return (false);
+}
+
+// y first so a falling body lands before sliding sideways. returns a bit per blocked axis
+int PhysicsEngine::move(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, glm::vec3 delta)
+{
+	int blocked = 0;
+	if (this->sweep(blocks, pos, size, 1, delta.y))
+		blocked |= 2;
+	if (this->sweep(blocks, pos, size, 0, delta.x))
+		blocked |= 1;
+	if (this->sweep(blocks, pos, size, 2, delta.z))
+		blocked |= 4;
+	return (blocked);
+}
+
+// a move along the ground that climbs ledges up to STEP_HEIGHT when walking
+// straight into them gets the body less far
+int PhysicsEngine::walk(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, glm::vec3 delta)
+{
+	glm::vec3 start = pos;
+	int blocked = this->move(blocks, pos, size, delta);
+	if (!(blocked & 5) || !this->isGrounded(blocks, start, size))
+		return (blocked);
+	glm::vec3 stepped = start;
+	if (this->sweep(blocks, stepped, size, 1, STEP_HEIGHT))
+		return (blocked); // no head room
+	int steppedBlocked = this->move(blocks, stepped, size, glm::vec3(delta.x, 0.0f, delta.z));
+	this->sweep(blocks, stepped, size, 1, -STEP_HEIGHT);
+	glm::vec2 flat(pos.x - start.x, pos.z - start.z);
+	glm::vec2 climbed(stepped.x - start.x, stepped.z - start.z);
+	if (glm::dot(climbed, climbed) <= glm::dot(flat, flat))
+		return (blocked);
+	pos = stepped;
+	return (steppedBlocked);
+}
+
+// one gravity step, velocity is downward. true when the body hit something
+// (landed or bumped its head), which stops it
+bool PhysicsEngine::fall(BlockAccessor &blocks, glm::vec3 &pos, glm::vec2 size, float &velocity, float time)
+{
+	velocity = min(velocity + GRAVITY * time, TERMINAL_VELOCITY);
+	if (!this->sweep(blocks, pos, size, 1, -velocity * time))
+		return (false);
+	velocity = 0.0f;
+	return (true);
+}
+
+bool PhysicsEngine::isGrounded(BlockAccessor &blocks, glm::vec3 pos, glm::vec2 size)
+{
+	return (this->sweep(blocks, pos, size, 1, -2.0f * PHYSICS_SKIN));
+}
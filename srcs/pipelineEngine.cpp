@@ -0,0 +1,301 @@
+#include <engine.hpp>
+#include <pipelineEngine.hpp>
+#include <terrain.hpp>
+
+static const glm::ivec2 sides[4] = {glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1)};
+
+WorkerPool::~WorkerPool(void)
+{
+	{
+		lock_guard<mutex> guard(this->lock);
+		this->quit = true;
+	}
+	this->wake.notify_all();
+	for (size_t i = 0; i < this->workers.size(); i++)
+		this->workers[i].join();
+}
+
+void WorkerPool::run(int count, int threads, const function<void(int)> &work)
+{
+	if (threads <= 0)
+		threads = max(1, (int)thread::hardware_concurrency());
+	threads = min(threads, count);
+	if (threads > 1 && this->workers.empty())
+		for (int i = 0; i < (int)thread::hardware_concurrency() - 1; i++)
+			this->workers.emplace_back(&WorkerPool::loop, this, i);
+	int helpers = min(threads - 1, (int)this->workers.size());
+	if (helpers <= 0)
+	{
+		for (int i = 0; i < count; i++)
+			work(i);
+		return ;
+	}
+	{
+		lock_guard<mutex> guard(this->lock);
+		this->work = &work;
+		this->count = count;
+		this->next = 0;
+		this->active = helpers;
+		this->busy = helpers;
+		this->round++;
+	}
+	this->wake.notify_all();
+	for (int i = this->next++; i < count; i = this->next++)
+		work(i);
+	unique_lock<mutex> guard(this->lock);
+	this->idle.wait(guard, [this]() { return (this->busy == 0); });
+	this->work = NULL;
+}
+
+// a run only starts once every worker of the one before is done with it, so an
+// active worker never misses one
+void WorkerPool::loop(int id)
+{
+	int seen = 0;
+	unique_lock<mutex> guard(this->lock);
+	while (true)
+	{
+		this->wake.wait(guard, [&]() { return (this->quit || this->round != seen); });
+		if (this->quit)
+			return ;
+		seen = this->round;
+		if (id >= this->active)
+			continue ;
+		const function<void(int)> *work = this->work;
+		int count = this->count;
+		guard.unlock();
+		for (int i = this->next++; i < count; i = this->next++)
+			(*work)(i);
+		guard.lock();
+		if (--this->busy == 0)
+			this->idle.notify_one();
+	}
+}
+
+void PipelineEngine::request(glm::ivec2 pos)
+{
+	this->wanted.push_back(pos);
+}
+
+// pos up to stage, with the stages of the neighbors that one reads
+void PipelineEngine::need(glm::ivec2 pos, ChunkStage stage)
+{
+	Chunk *c = this->terr->getChunk(pos);
+	ChunkStage done = c ? c->getStage() : NOTHING_DONE;
+	if (done >= stage)
+		return ;
+	auto it = this->needed.find(pos);
+	if (it != this->needed.end() && it->second >= stage)
+		return ;
+	if (it == this->needed.end())
+		this->order.push_back(pos);
+	this->needed[pos] = stage;
+	if (stage >= MESH_DONE && done < MESH_DONE)
+		for (int i = 0; i < 4; i++)
+			this->need(pos + sides[i], STRUCTURES_DONE);
+	if (stage >= STRUCTURES_DONE && done < STRUCTURES_DONE)
+		for (int i = -1; i <= 1; i++)
+			for (int j = -1; j <= 1; j++)
+				if (i || j)
+					this->need(pos + glm::ivec2(i, j), TERRAIN_DONE);
+}
+
+// whether the neighbors stage reads are far enough along
+bool PipelineEngine::ready(glm::ivec2 pos, ChunkStage stage)
+{
+	Chunk *n;
+	if (stage == STRUCTURES_DONE)
+		for (int i = -1; i <= 1; i++)
+			for (int j = -1; j <= 1; j++)
+				if ((i || j) && (!(n = this->terr->getChunk(pos + glm::ivec2(i, j))) || n->getStage() < TERRAIN_DONE))
+					return (false);
+	if (stage == MESH_DONE)
+		for (int i = 0; i < 4; i++)
+			if (!(n = this->terr->getChunk(pos + sides[i])) || n->getStage() < STRUCTURES_DONE)
+				return (false);
+	return (true);
+}
+
+// c and the neighbors with terrain point at each other, the stages after
+// terrain read the neighbors through these
+void PipelineEngine::link(Chunk *c)
+{
+	glm::ivec2 pos(c->getXOff(), c->getZOff());
+	for (int i = 0; i < 4; i++)
+	{
+		Chunk *n = this->terr->getChunk(pos + sides[i]);
+		if (!n || n->getStage() < TERRAIN_DONE)
+			continue ;
+		if (i == 0)
+		{
+			c->setXMinus(n);
+			n->setXPlus(c);
+		}
+		else if (i == 1)
+		{
+			c->setXPlus(n);
+			n->setXMinus(c);
+		}
+		else if (i == 2)
+		{
+			c->setZMinus(n);
+			n->setZPlus(c);
+		}
+		else
+		{
+			c->setZPlus(n);
+			n->setZMinus(c);
+		}
+		n->neighborsSet = n->getXMinus() && n->getXPlus() && n->getZMinus() && n->getZPlus();
+	}
+	c->neighborsSet = c->getXMinus() && c->getXPlus() && c->getZMinus() && c->getZPlus();
+}
+
+// once every chunk around one pulled its spills they count as handed out, kept in
+// spilled like neighborQueueUnload does for a neighbor generated there again
+void PipelineEngine::retire(glm::ivec2 pos)
+{
+	for (int i = -1; i <= 1; i++)
+		for (int j = -1; j <= 1; j++)
+		{
+			glm::ivec2 p = pos + glm::ivec2(i, j);
+			Chunk *c = this->terr->getChunk(p);
+			if (!c || c->neighborQueue.empty())
+				continue ;
+			bool pulled = true;
+			for (int k = -1; k <= 1 && pulled; k++)
+				for (int l = -1; l <= 1 && pulled; l++)
+				{
+					Chunk *n = this->terr->getChunk(p + glm::ivec2(k, l));
+					pulled = (!k && !l) || (n && n->getStage() >= STRUCTURES_DONE);
+				}
+			if (!pulled)
+				continue ;
+			c->spilled.insert(c->spilled.end(), c->neighborQueue.begin(), c->neighborQueue.end());
+			c->neighborQueue.clear();
+		}
+}
+
+// the next stage of every needed chunk that's ready, up to jobs of them on the pool and
+// uploads meshes on this thread. false when nothing was requested
+bool PipelineEngine::wave(int jobs, int uploads, int threads)
+{
+	if (this->wanted.empty())
+		return (false);
+	this->needed.clear();
+	this->order.clear();
+	for (size_t i = 0; i < this->wanted.size(); i++)
+		this->need(this->wanted[i], UPLOAD_DONE);
+	this->wanted.clear();
+
+	vector<Chunk *> work;
+	vector<Chunk *> upload;
+	for (size_t i = 0; i < this->order.size(); i++)
+	{
+		glm::ivec2 pos = this->order[i];
+		Chunk *c = this->terr->getChunk(pos);
+		ChunkStage next = (ChunkStage)((c ? c->getStage() : NOTHING_DONE) + 1);
+		if (next == UPLOAD_DONE)
+		{
+			if ((int)upload.size() < uploads)
+				upload.push_back(c);
+			continue ;
+		}
+		if ((int)work.size() >= jobs || !this->ready(pos, next))
+			continue ;
+		if (!c)
+			c = this->terr->addChunk(pos);
+		work.push_back(c);
+	}
+
+	// the 3x3s the structure stages pull from, the world map is only read on this thread
+	vector<Chunk *> around(work.size() * 9);
+	for (size_t i = 0; i < work.size(); i++)
+		if (work[i]->getStage() + 1 == STRUCTURES_DONE)
+			for (int j = 0; j < 9; j++)
+				around[i * 9 + j] = this->terr->getChunk(glm::ivec2(work[i]->getXOff() + j / 3 - 1, work[i]->getZOff() + j % 3 - 1));
+
+	// a stage only writes its own chunk, and nothing reads what another stage of the
+	// same wave writes: those neighbors were far enough along before it started
+	this->pool.run(work.size(), threads, [&](int i) {
+		Chunk *c = work[i];
+		switch (c->getStage() + 1)
+		{
+			case TERRAIN_DONE:
+				c->setTerrain();
+				break ;
+			case STRUCTURES_DONE:
+				c->pullTerrainFromNeighbors(&around[i * 9]);
+				break ;
+			case LIGHT_DONE:
+			{
+				LightEngine light; // sunlight stays inside its chunk, each one gets a queue of its own
+				light.sunlightInit(c);
+				break ;
+			}
+			default:
+				c->mesh();
+		}
+	});
+	for (size_t i = 0; i < work.size(); i++)
+	{
+		work[i]->setStage((ChunkStage)(work[i]->getStage() + 1));
+		this->stages[work[i]->getStage()]++;
+	}
+	for (size_t i = 0; i < work.size(); i++)
+	{
+		if (work[i]->getStage() == TERRAIN_DONE)
+			this->link(work[i]);
+		else if (work[i]->getStage() == STRUCTURES_DONE)
+			this->retire(glm::ivec2(work[i]->getXOff(), work[i]->getZOff()));
+	}
+	for (size_t i = 0; i < upload.size(); i++)
+	{
+		upload[i]->buildVAO();
+		upload[i]->setStage(UPLOAD_DONE);
+		this->stages[UPLOAD_DONE]++;
+	}
+	return (true);
+}
+
+bool PipelineEngine::update(void)
+{
+	return (this->wave(PIPELINE_JOBS, PIPELINE_UPLOADS, 0));
+}
+
+// waves for pos alone, the frame's requests wait for the next update
+void PipelineEngine::finish(glm::ivec2 pos)
+{
+	vector<glm::ivec2> requested;
+	requested.swap(this->wanted);
+	for (Chunk *c = this->terr->getChunk(pos); !c || c->getStage() < UPLOAD_DONE; c = this->terr->getChunk(pos))
+	{
+		this->wanted.push_back(pos);
+		this->wave(INT_MAX, INT_MAX, 0);
+	}
+	this->wanted.swap(requested);
+}
+
+// the render radius around center before the first frame, in waves on all cores (or
+// threads of them). progress counts stages, UPLOAD_DONE per chunk
+void PipelineEngine::pregenerate(glm::ivec2 center, int radius, void (*progress)(int done, int total), int threads)
+{
+	int total = (radius * 2 - 1) * (radius * 2 - 1) * UPLOAD_DONE;
+	while (true)
+	{
+		int done = 0;
+		for (int i = -radius + 1; i < radius; i++)
+			for (int j = -radius + 1; j < radius; j++)
+			{
+				glm::ivec2 pos = center + glm::ivec2(i, j);
+				Chunk *c = this->terr->getChunk(pos);
+				done += c ? c->getStage() : NOTHING_DONE;
+				if (!c || c->getStage() < UPLOAD_DONE)
+					this->wanted.push_back(pos);
+			}
+		if (progress)
+			progress(done, total);
+		if (!this->wave(PIPELINE_WAVE, PIPELINE_WAVE, threads))
+			break ;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <engine.hpp>
+#include <replayEngine.hpp>
+#include <algorithm>
+
+ReplayEngine::~ReplayEngine()
+{
+	if (this->out)
+		fclose(this->out);
+}
+
+bool ReplayEngine::record(const string &path, int seed, Player *player)
+{
+	if (!(this->out = fopen(path.c_str(), "wb")))
+		return (false);
+	this->header.magic = REPLAY_MAGIC;
+	this->header.seed = seed;
+	this->header.start = player->getPosition();
+	this->header.yaw = player->camera->Yaw;
+	this->header.pitch = player->camera->Pitch;
+	fwrite(&this->header, sizeof(this->header), 1, this->out);
+	return (true);
+}
+
+bool ReplayEngine::load(const string &path)
+{
+	FILE *in = fopen(path.c_str(), "rb");
+	if (!in)
+		return (false);
+	ReplayRecord record;
+	bool valid = fread(&this->header, sizeof(this->header), 1, in) == 1 && this->header.magic == REPLAY_MAGIC;
+	while (valid && fread(&record, sizeof(record), 1, in) == 1)
+	{
+		ReplayFrame frame;
+		frame.deltaTime = record.deltaTime;
+		frame.input.keys = record.keys;
+		frame.input.clicks = record.clicks;
+		frame.input.yaw = record.yaw;
+		frame.input.pitch = record.pitch;
+		frame.position = glm::vec3(record.position[0], record.position[1], record.position[2]);
+		this->frames.push_back(frame);
+	}
+	fclose(in);
+	return (valid && !this->frames.empty());
+}
+
+// flushed every frame, a crash still leaves a log that replays up to it
+void ReplayEngine::write(float deltaTime, const PlayerInput &input, glm::vec3 position)
+{
+	ReplayRecord record = {};
+	record.deltaTime = deltaTime;
+	record.keys = input.keys;
+	record.clicks = input.clicks;
+	record.yaw = input.yaw;
+	record.pitch = input.pitch;
+	record.position[0] = position.x;
+	record.position[1] = position.y;
+	record.position[2] = position.z;
+	fwrite(&record, sizeof(record), 1, this->out);
+	fflush(this->out);
+}
+
+bool ReplayEngine::next(ReplayFrame &frame)
+{
+	if (this->current >= this->frames.size())
+		return (false);
+	frame = this->frames[this->current++];
+	return (true);
+}
+
+void ReplayEngine::check(glm::vec3 position)
+{
+	if (this->current)
+		this->drift = max(this->drift, glm::length(position - this->frames[this->current - 1].position));
+}
+
+void FrameTimer::begin()
+{
+	Clock::time_point now = Clock::now();
+	if (this->running)
+		this->frames.push_back(std::chrono::duration<float, std::milli>(now - this->frameStart).count());
+	this->frameStart = this->stageStart = now;
+	this->running = true;
+}
+
+void FrameTimer::stage(FrameStage s)
+{
+	Clock::time_point now = Clock::now();
+	this->stages[s] += std::chrono::duration<double, std::milli>(now - this->stageStart).count();
+	this->stageStart = now;
+}
+
+void FrameTimer::end()
+{
+	if (this->running)
+		this->begin();
+	this->running = false;
+}
+
+float FrameTimer::percentile(float p)
+{
+	if (this->sorted.size() != this->frames.size())
+	{
+		this->sorted = this->frames;
+		sort(this->sorted.begin(), this->sorted.end());
+	}
+	if (this->sorted.empty())
+		return (0.0f);
+	return (this->sorted[min((size_t)(p * this->sorted.size()), this->sorted.size() - 1)]);
+}
+
+double FrameTimer::total()
+{
+	double total = 0.0;
+	for (size_t i = 0; i < this->frames.size(); i++)
+		total += this->frames[i];
+	return (total);
+}
+
+const char *FrameTimer::stageName(int s)
+{
+	static const char *names[STAGES] = {"input", "chunks", "lod", "water", "threads", "updates", "swap"};
+	return (names[s]);
+}
+
+void FrameTimer::report()
+{
+	this->end();
+	if (this->frames.empty())
+		return ;
+	double total = this->total();
+	cout << this->frames.size() << " frames in " << total / 1000.0 << " s, " << this->frames.size() / (total / 1000.0) << " fps" << endl;
+	cout << "frame ms: p50 " << this->percentile(0.5f) << " p90 " << this->percentile(0.9f)
+		<< " p99 " << this->percentile(0.99f) << " max " << this->percentile(1.0f) << endl;
+	for (int s = 0; s < STAGES; s++)
+		cout << "  " << stageName(s) << ": " << this->stages[s] / this->frames.size() << " ms per frame, "
+			<< (int)(this->stages[s] * 100.0 / max(total, 1e-9)) << "%" << endl;
+}
\ No newline at end of file
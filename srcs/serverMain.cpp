@@ -0,0 +1,20 @@
+#include <engine.hpp>
+#include <terrain.hpp>
+#include <networkEngine.hpp>
+
+// ./server [port] [seed] owns the world, ./engine --connect host[:port] renders it
+int main(int argc, char **argv)
+{
+	int port = (argc > 1) ? atoi(argv[1]) : SERVER_PORT;
+	Terrain *terr = (argc > 2) ? new Terrain(atoi(argv[2])) : new Terrain();
+	ServerEngine server(terr, port);
+	if (!server.getPort())
+	{
+		cout << "could not listen on port " << port << endl;
+		return (1);
+	}
+	cout << "listening on port " << server.getPort() << ", seed " << terr->getSeed() << endl;
+	for (;;)
+		server.update(100);
+	return (0);
+}
\ No newline at end of file
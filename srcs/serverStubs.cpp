@@ -0,0 +1,25 @@
+#include <engine.hpp>
+
+// the server links without glfw, gl or assimp. chunk and lodEngine still reference a
+// few gl calls, they do nothing here: without a current context no chunk is uploaded
+extern "C"
+{
+GLFWwindow *glfwGetCurrentContext(void) { return (NULL); }
+
+void glGenVertexArrays(GLsizei n, GLuint *arrays) { memset(arrays, 0, n * sizeof(GLuint)); }
+void glGenBuffers(GLsizei n, GLuint *buffers) { memset(buffers, 0, n * sizeof(GLuint)); }
+void glDeleteVertexArrays(GLsizei n, const GLuint *arrays) { (void)n; (void)arrays; }
+void glDeleteBuffers(GLsizei n, const GLuint *buffers) { (void)n; (void)buffers; }
+void glBindVertexArray(GLuint array) { (void)array; }
+void glBindBuffer(GLenum target, GLuint buffer) { (void)target; (void)buffer; }
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) { (void)target; (void)size; (void)data; (void)usage; }
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) { (void)target; (void)offset; (void)size; (void)data; }
+void glEnableVertexAttribArray(GLuint index) { (void)index; }
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer) { (void)index; (void)size; (void)type; (void)normalized; (void)stride; (void)pointer; }
+void glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer) { (void)index; (void)size; (void)type; (void)stride; (void)pointer; }
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) { (void)mode; (void)first; (void)count; }
+void glMultiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount) { (void)mode; (void)first; (void)count; (void)drawcount; }
+GLint glGetUniformLocation(GLuint program, const GLchar *name) { (void)program; (void)name; return (-1); }
+void glUniform1f(GLint location, GLfloat v0) { (void)location; (void)v0; }
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) { (void)location; (void)count; (void)transpose; (void)value; }
+}
\ No newline at end of file
@@ -1,9 +1,17 @@
 #include <engine.hpp>
 #include <terrain.hpp>
+#include <physicsEngine.hpp>
+#include <entityEngine.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 #define CHUNKS_PER_LOOP 1
+#define YSQRT sqrt(CHUNK_Y-1)
 
-Terrain::Terrain(void)
+Terrain::Terrain(void) : Terrain((int)std::time(0)) {}
+
+Terrain::Terrain(int seed) : seed(seed)
 {
 	this->structureEngine = new StructureEngine();
 	this->temperatureNoise = new FastNoise();
@@ -11,8 +19,16 @@ Terrain::Terrain(void)
 	this->terrainNoise1 = new FastNoise();
 	this->terrainNoise2 = new FastNoise();
 	this->terrainNoise3 = new FastNoise();
+	this->densityNoise = new FastNoise();
+	this->biomeEngine = new BiomeEngine(this);
 	this->setNoise();
+	this->chunkPool = new ChunkPool();
 	this->lightEngine = new LightEngine();
+	this->lodEngine = new LodEngine(this);
+	this->occlusionEngine = new OcclusionEngine();
+	this->physicsEngine = new PhysicsEngine();
+	this->entityEngine = new EntityEngine(this);
+	this->pipelineEngine = new PipelineEngine(this);
 }
 
 Terrain::~Terrain(void)
@@ -23,22 +39,36 @@ Terrain::~Terrain(void)
 	delete this->terrainNoise1;
 	delete this->terrainNoise2;
 	delete this->terrainNoise3;
+	delete this->densityNoise;
+	delete this->biomeEngine;
+	delete this->chunkPool;
 	delete this->lightEngine;
+	delete this->lodEngine;
+	delete this->occlusionEngine;
+	delete this->physicsEngine;
+	delete this->entityEngine;
+	delete this->pipelineEngine;
 }
 
 void Terrain::updateChunk(glm::ivec2 pos)
 {
-	Chunk *c;
-	if ((c = this->getChunk(pos))) // built may be the interchangable with neighborsSet
-	{				
+	Chunk *c = this->getChunk(pos);
+	if (this->staged && this->generate && (!c || c->getStage() < UPLOAD_DONE))
+	{ // right away, with the neighbors it depends on
+		this->pipelineEngine->finish(pos);
+		return ;
+	}
+	if (c) // built may be the interchangable with neighborsSet
+	{
 		c->clearSunLightMap();
 		if (!c->neighborQueue.empty())
 			c->neighborQueueUnload();
 	}
+	else if (!this->generate) // still on its way from the server
+		return ;
 	else
 	{ // new chunk
-		c = new Chunk(pos.x, pos.y, this);
-		this->world[pos] = c;
+		c = this->addChunk(pos);
 		this->setNeighbors(pos);		
 		c->setTerrain();		
 	}
@@ -46,39 +76,178 @@ void Terrain::updateChunk(glm::ivec2 pos)
 	c->update();
 }
 
-bool Terrain::renderChunk(glm::ivec2 pos, Shader shader)
+Chunk *Terrain::addChunk(glm::ivec2 pos)
 {
-	Chunk *c;
-	if ((c = getChunk(pos)) && c->getState() == RENDER)
+	Chunk *c = this->chunkPool->acquire(pos.x, pos.y, this);
+	this->world[pos] = c;
+	return (c);
+}
+
+void Terrain::unloadChunk(glm::ivec2 pos)
+{
+	Chunk *c = this->getChunk(pos);
+	if (!c)
+		return ;
+	const glm::ivec2 sides[4] = {glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1)};
+	for (int i = 0; i < 4; i++)
+	{
+		Chunk *n = this->getChunk(pos + sides[i]);
+		if (n)
+			n->forgetNeighbor(c);
+	}
+	this->world.erase(pos);
+	this->chunkPool->release(c);
+}
+
+// hands the chunks radius or more away from center back to the pool. edited ones stay
+// unless told otherwise, generating them again from the seed would undo the edits
+int Terrain::unloadChunks(glm::ivec2 center, int radius, bool keepEdited)
+{
+	vector<glm::ivec2> far;
+	for (auto it = this->world.begin(); it != this->world.end(); it++)
+	{
+		glm::ivec2 d = it->first - center;
+		if (max(abs(d.x), abs(d.y)) >= radius && !(keepEdited && it->second->edited))
+			far.push_back(it->first);
+	}
+	for (size_t i = 0; i < far.size(); i++)
+		this->unloadChunk(far[i]);
+	return (far.size());
+}
+
+// runs work(i) for every i below count on worker threads while this one reports progress
+static void parallelFor(int count, int threads, int done, int total, void (*progress)(int, int), const std::function<void(int)> &work)
+{
+	atomic<int> next(0);
+	atomic<int> finished(0);
+	vector<thread> workers;
+	for (int t = 0; t < min(threads, count); t++)
+		workers.emplace_back([&]() {
+			for (int i = next++; i < count; i = next++)
+			{
+				work(i);
+				finished++;
+			}
+		});
+	while (progress && finished < count)
+	{
+		progress(done + finished, total);
+		this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+// fills the render radius around center before the first frame instead of a chunk
+// per frame: terrain on all cores, structures spilling over handed out in one go,
+// then light and meshes on all cores again. only the uploads stay on this thread
+void Terrain::pregenerate(glm::ivec2 center, int radius, void (*progress)(int done, int total), int threads)
+{
+	if (this->staged)
 	{
-		c->render(shader);
-		if (!c->neighborsSet)
+		this->pipelineEngine->pregenerate(center, radius, progress, threads);
+		return ;
+	}
+	vector<Chunk *> chunks;
+	for (int i = -radius + 1; i < radius; i++)
+		for (int j = -radius + 1; j < radius; j++)
+		{
+			glm::ivec2 pos = center + glm::ivec2(i, j);
+			if (this->getChunk(pos))
+				continue ;
+			chunks.push_back(this->addChunk(pos));
+		}
+	if (threads <= 0)
+		threads = max(1, (int)thread::hardware_concurrency());
+	int count = chunks.size();
+	int total = count * 3;
+
+	// a chunk only writes its own blocks here, the rest waits in its neighborQueue
+	parallelFor(count, threads, 0, total, progress, [&](int i) { chunks[i]->setTerrain(); });
+	for (int i = 0; i < count; i++)
+		this->setNeighbors(glm::ivec2(chunks[i]->getXOff(), chunks[i]->getZOff()));
+	for (int i = 0; i < count; i++)
+		chunks[i]->neighborQueueUnload();
+	// sunlight stays inside its chunk, so each one gets a queue of its own
+	parallelFor(count, threads, count, total, progress, [&](int i) {
+		LightEngine light;
+		light.sunlightInit(chunks[i]);
+		chunks[i]->mesh();
+	});
+	for (int i = 0; i < count; i++)
+	{
+		chunks[i]->buildVAO();
+		if (progress && i % 64 == 0)
+			progress(count * 2 + i, total);
+	}
+	if (progress)
+		progress(total, total);
+}
+
+// the chunk to draw at pos, NULL when there's none yet. one that's missing or changed is
+// queued: new ones go to the pipeline, changed ones and all of them when it's off to updateList
+Chunk *Terrain::requestChunk(glm::ivec2 pos)
+{
+	Chunk *c = this->getChunk(pos);
+	if (this->staged && this->generate && (!c || c->getStage() < UPLOAD_DONE))
+	{
+		this->pipelineEngine->request(pos);
+		return (NULL);
+	}
+	if (c && c->getState() == RENDER)
+	{
+		if (!c->neighborsSet && !this->staged) // the pipeline links them
 			this->setNeighbors(pos);
+		return (c);
 	}
-	else if (this->updateList.size() < CHUNKS_PER_LOOP)
+	if (this->updateList.size() < CHUNKS_PER_LOOP)
 	{
 		this->updateList.push(pos);
-		return (false);
+		return (NULL);
 	}
-	else if ((c = getChunk(pos)) && c->getState() == UPDATE) // render till fits on updateList
-		c->render(shader);
-	return (true);
+	if (c && c->getState() == UPDATE) // render till fits on updateList
+		return (c);
+	return (NULL);
+}
+
+bool Terrain::renderChunk(glm::ivec2 pos, Shader shader, glm::vec3 viewPos)
+{
+	Chunk *c = this->requestChunk(pos);
+	if (c)
+		c->render(shader, viewPos, this->stats);
+	return (c != NULL);
 }
 
 bool Terrain::renderWaterChunk(glm::ivec2 pos, Shader shader)
 {
 	Chunk *c;
 	if ((c = getChunk(pos)))
-		c->renderWater(shader);
+		c->renderWater(shader, this->stats);
 	else
 		return (false);
 	return (true);
 }
 
+// heightmap generation, in world block coordinates
+int	Terrain::getBase(int x, int z)
+{
+	float b1 = MAP(this->terrainLayer1.getNoise(x,z), -1.0f, 1.0f, 0.1f, YSQRT);
+	// float b2 = MAP(this->terrainLayer2.getNoise(x,z), -1.0f, 1.0f, 0.1f, YSQRT);
+	// float b3 = MAP(this->terrainLayer3.getNoise(x,z), -1.0f, 1.0f, 0.1f, YSQRT);
+	// return (pow((b1+b2+b3)/3, 2));
+	return (pow(b1, 2));
+}
+
+// surface block type, in world block coordinates
+short Terrain::getBiome(int x, int z)
+{
+	return (this->biomeEngine->getBiome(x, z));
+}
+
 // init
 void Terrain::setNoise(void)
 {
-	this->terrainNoise1->SetSeed(std::time(0));
+	this->terrainNoise1->SetSeed(this->seed);
 	this->terrainNoise1->SetNoiseType(FastNoise::PerlinFractal);
 	this->terrainNoise1->SetFrequency(0.004f); // hills
 	this->terrainNoise1->SetFractalOctaves(1);
@@ -100,9 +269,21 @@ void Terrain::setNoise(void)
 	this->temperatureNoise->SetNoiseType(FastNoise::PerlinFractal);
 	this->temperatureNoise->SetFrequency(0.001f);
 
-	this->temperatureNoise->SetSeed(terrainNoise1->GetSeed()*2);
+	this->humidityNoise->SetSeed(terrainNoise1->GetSeed()*2);
 	this->humidityNoise->SetNoiseType(FastNoise::Perlin);
 	this->humidityNoise->SetFrequency(0.001f);
+
+	this->densityNoise->SetSeed(terrainNoise1->GetSeed() ^ 0x5bd1e995);
+	this->densityNoise->SetNoiseType(FastNoise::PerlinFractal);
+	this->densityNoise->SetFrequency(0.03f); // caves and overhangs
+	this->densityNoise->SetFractalOctaves(2);
+
+	this->terrainLayer1.set(*this->terrainNoise1);
+	this->terrainLayer2.set(*this->terrainNoise2);
+	this->terrainLayer3.set(*this->terrainNoise3);
+	this->temperatureLayer.set(*this->temperatureNoise);
+	this->humidityLayer.set(*this->humidityNoise);
+	this->biomeEngine->clear();
 }
 
 
@@ -128,4 +309,291 @@ void Terrain::setNeighbors(glm::ivec2 pos)
 		if (!c->neighborQueue.empty())
 			c->neighborQueueUnload();
 	}
+}
+// two pass LSD radix sort on the upper 16 bits (the key), stable so equal
+// distances keep their sweep order
+static void radixSort(vector<uint32_t> &items)
+{
+	vector<uint32_t> tmp(items.size());
+	for (int shift = 16; shift < 32; shift += 8)
+	{
+		unsigned int count[257] = {0};
+		for (size_t i = 0; i < items.size(); i++)
+			count[((items[i] >> shift) & 0xff) + 1]++;
+		for (int i = 0; i < 256; i++)
+			count[i + 1] += count[i];
+		for (size_t i = 0; i < items.size(); i++)
+			tmp[count[(items[i] >> shift) & 0xff]++] = items[i];
+		items.swap(tmp);
+	}
+}
+
+// orders the chunks within radius front to back by squared chunk distance,
+// only redone when the player crosses a chunk boundary or the radius grows
+void Terrain::sortRenderOrder(glm::ivec2 center, int radius)
+{
+	if (center == this->renderCenter && radius == this->renderRadius)
+		return ;
+	this->renderCenter = center;
+	this->renderRadius = radius;
+
+	vector<glm::ivec2> offsets;
+	vector<uint32_t> keys;
+	for (int i = -radius + 1; i < radius; i++)
+	{
+		for (int j = -radius + 1; j < radius; j++)
+		{
+			// key in the upper 16 bits, index into offsets in the lower 16
+			keys.push_back(((uint32_t)(i * i + j * j) << 16) | (uint32_t)offsets.size());
+			offsets.push_back(glm::ivec2(i, j));
+		}
+	}
+	radixSort(keys);
+
+	this->renderOrder.clear();
+	for (size_t i = 0; i < keys.size(); i++)
+		this->renderOrder.push_back(center + offsets[keys[i] & 0xffff]);
+}
+
+// breadth first walk from the camera's section through faces its neighbors
+// connect, marking every chunk reached as visible this frame
+// https://tomcc.github.io/2014/08/31/visibility-1.html
+bool Terrain::findVisible(glm::vec3 viewPos, glm::ivec2 center, int radius)
+{
+	static const int opposite[6] = {1, 0, 4, 5, 2, 3};
+	static const glm::ivec2 step[6] = {
+		glm::ivec2(0, 0), glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(0, 1), glm::ivec2(-1, 0), glm::ivec2(0, -1)
+	};
+	Chunk *start = this->getChunk(center);
+	if (!start || start->getState() == GENERATE)
+		return (false);
+	this->frame++;
+
+	int sy = glm::clamp((int)floor(viewPos.y) / SECTION_Y, 0, SECTIONS - 1);
+	start->sectionVisit[sy] = this->frame;
+	start->visibleFrame = this->frame;
+	this->sectionQueue.clear();
+	this->sectionQueue.push_back(SectionNode(start, sy, -1, 0));
+	for (size_t head = 0; head < this->sectionQueue.size(); head++)
+	{
+		SectionNode node = this->sectionQueue[head];
+		glm::ivec2 pos(node.chunk->getXOff(), node.chunk->getZOff());
+		for (int out = 0; out < 6; out++)
+		{
+			if (node.in >= 0 && (out == node.in || !node.chunk->sectionConnected(node.section, node.in, out)))
+				continue ;
+			if (node.dirs & (1 << opposite[out]))
+				continue ;
+
+			Chunk *next = node.chunk;
+			int section = node.section;
+			if (out == 0)
+				section--;
+			else if (out == 1)
+				section++;
+			else
+			{
+				glm::ivec2 npos = pos + step[out];
+				if (abs(npos.x - center.x) >= radius || abs(npos.y - center.y) >= radius)
+					continue ;
+				next = (out == 2) ? node.chunk->getXPlus() : (out == 3) ? node.chunk->getZPlus()
+					: (out == 4) ? node.chunk->getXMinus() : node.chunk->getZMinus();
+				if (!next)
+					next = this->getChunk(npos);
+			}
+			if (section < 0 || section >= SECTIONS || !next || next->sectionVisit[section] == this->frame)
+				continue ;
+			next->sectionVisit[section] = this->frame;
+			next->visibleFrame = this->frame;
+			this->sectionQueue.push_back(SectionNode(next, section, opposite[out], node.dirs | (1 << out)));
+		}
+	}
+	return (true);
+}
+
+// section graph walk followed by an occlusion pass over the survivors, front to
+// back so every chunk is tested against the ground drawn by the ones before it
+bool Terrain::cullChunks(glm::vec3 viewPos, glm::mat4 viewProjection, glm::ivec2 center, int radius)
+{
+	if (!this->caveCulling || !this->findVisible(viewPos, center, radius))
+	{
+		if (!this->occlusionCulling)
+			return (false);
+		this->frame++;
+		for (size_t i = 0; i < this->renderOrder.size(); i++)
+			if (Chunk *c = this->getChunk(this->renderOrder[i]))
+				c->visibleFrame = this->frame;
+	}
+	if (!this->occlusionCulling)
+		return (true);
+
+	this->occlusionEngine->clear(viewProjection);
+	for (size_t i = 0; i < this->renderOrder.size(); i++)
+	{
+		glm::ivec2 pos = this->renderOrder[i];
+		Chunk *c = this->getChunk(pos);
+		if (!c || c->getState() != RENDER || c->visibleFrame != this->frame)
+			continue ;
+		if (c->isOccluded(this->occlusionEngine))
+		{
+			c->visibleFrame = -1;
+			this->stats.chunksOccluded++;
+			continue ;
+		}
+		if (abs(pos.x - center.x) < OCCLUDER_RADIUS && abs(pos.y - center.y) < OCCLUDER_RADIUS)
+			c->drawOccluder(this->occlusionEngine);
+	}
+	return (true);
+}
+
+// chunks not meshed yet are never culled so renderChunk can still queue them
+bool Terrain::isCulled(glm::ivec2 pos)
+{
+	Chunk *c = this->getChunk(pos);
+	return (c && c->getState() == RENDER && c->visibleFrame != this->frame);
+}
+
+// neighbor pointers first, a step across a chunk border lands in one of them
+bool BlockAccessor::setChunk(glm::ivec2 pos)
+{
+	Chunk *c = NULL;
+	if (this->chunk)
+	{
+		glm::ivec2 d = pos - this->chunkPos;
+		if (d == glm::ivec2(-1, 0))
+			c = this->chunk->getXMinus();
+		else if (d == glm::ivec2(1, 0))
+			c = this->chunk->getXPlus();
+		else if (d == glm::ivec2(0, -1))
+			c = this->chunk->getZMinus();
+		else if (d == glm::ivec2(0, 1))
+			c = this->chunk->getZPlus();
+	}
+	if (!c)
+		c = this->terr->getChunk(pos);
+	this->chunk = c;
+	this->chunkPos = pos;
+	return (c != NULL);
+}
+
+RaycastHit Terrain::raycast(glm::vec3 origin, glm::vec3 dir, float maxDist)
+{
+	BlockAccessor blocks(this);
+	return (this->raycast(origin, dir, maxDist, blocks));
+}
+
+// block traversal algorithm http://www.cse.yorku.ca/~amana/research/grid.pdf
+// in world coordinates, stops at maxDist blocks or where the loaded world ends
+RaycastHit Terrain::raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, BlockAccessor &blocks)
+{
+	RaycastHit hit;
+	if (glm::length(dir) == 0.0f)
+		return (hit);
+	dir = glm::normalize(dir);
+	glm::ivec3 cell(floor(origin.x), floor(origin.y), floor(origin.z));
+	glm::ivec3 step;
+	glm::vec3 tMax; // distance along the ray to the next cell border on each axis
+	glm::vec3 tDelta; // distance between two borders on each axis
+	for (int i = 0; i < 3; i++)
+	{
+		step[i] = (dir[i] > 0.0f) - (dir[i] < 0.0f);
+		if (!step[i])
+		{
+			tMax[i] = tDelta[i] = INFINITY;
+			continue ;
+		}
+		tDelta[i] = fabs(1.0f / dir[i]);
+		tMax[i] = ((step[i] > 0) ? cell[i] + 1 - origin[i] : origin[i] - cell[i]) * tDelta[i];
+	}
+
+	glm::ivec3 previous = cell;
+	int axis = -1;
+	float t = 0.0f;
+	while (t <= maxDist)
+	{
+		Block *b = blocks.getBlock(cell);
+		if (!blocks.getChunk())
+			break ;
+		if (b && b->isSolid())
+		{
+			hit.hit = true;
+			hit.pos = cell;
+			hit.previous = previous;
+			hit.normal = glm::ivec3(0);
+			if (axis >= 0)
+				hit.normal[axis] = -step[axis];
+			hit.distance = t;
+			hit.block = b;
+			hit.chunk = blocks.getChunk();
+			return (hit);
+		}
+		// nothing above or below the chunks to hit once the ray leaves them
+		if ((cell.y < 0 && step.y <= 0) || (cell.y >= CHUNK_Y && step.y >= 0))
+			break ;
+		previous = cell;
+		axis = (tMax.x < tMax.y) ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+		t = tMax[axis];
+		cell[axis] += step[axis];
+		tMax[axis] += tDelta[axis];
+	}
+	return (hit);
+}
+
+// rays cast one after another through a shared accessor, so rays fanning out
+// from the same spot (line of sight checks, light probes) keep hitting the cached chunk
+void Terrain::raycastBatch(const vector<glm::vec3> &origins, const vector<glm::vec3> &dirs, float maxDist, vector<RaycastHit> &hits)
+{
+	BlockAccessor blocks(this);
+	hits.resize(origins.size());
+	for (size_t i = 0; i < origins.size(); i++)
+		hits[i] = this->raycast(origins[i], dirs[i], maxDist, blocks);
+}
+
+// remeshes the chunk holding a changed block, and the neighbors sharing a face with it
+void Terrain::updateBlock(glm::ivec3 pos)
+{
+	glm::ivec2 c(floorDiv(pos.x, CHUNK_X), floorDiv(pos.z, CHUNK_Z));
+	glm::ivec3 local(pos.x - c.x * CHUNK_X, pos.y, pos.z - c.y * CHUNK_Z);
+	if (!this->getChunk(c))
+		return ;
+	this->updateChunk(c);
+	// edge blocks changed require neighbor chunk updates too
+	if (local.x == 0 && this->getChunk(glm::ivec2(c.x - 1, c.y)))
+		this->updateChunk(glm::ivec2(c.x - 1, c.y));
+	if (local.x == CHUNK_X - 1 && this->getChunk(glm::ivec2(c.x + 1, c.y)))
+		this->updateChunk(glm::ivec2(c.x + 1, c.y));
+	if (local.z == 0 && this->getChunk(glm::ivec2(c.x, c.y - 1)))
+		this->updateChunk(glm::ivec2(c.x, c.y - 1));
+	if (local.z == CHUNK_Z - 1 && this->getChunk(glm::ivec2(c.x, c.y + 1)))
+		this->updateChunk(glm::ivec2(c.x, c.y + 1));
+}
+
+// changes a block in world coordinates, keeping torch light and the meshes around it up to
+// date. without remesh the caller updates the chunks once it changed all its blocks
+bool Terrain::setBlock(glm::ivec3 pos, int type, bool remesh)
+{
+	BlockAccessor blocks(this);
+	Block *b = blocks.getBlock(pos);
+	if (!b)
+		return (false);
+	Chunk *c = blocks.getChunk();
+	glm::ivec3 p = blocks.toLocal(pos);
+	if (b->getLight())
+	{
+		short val = (short)c->getTorchLight(p.x, p.y, p.z);
+		this->lightEngine->lightRemovalBfsQueue.emplace(p.x, p.y, p.z, val, c);
+		c->setTorchLight(p.x, p.y, p.z, 0);
+		this->lightEngine->removedLighting();
+	}
+	b->setType(type);
+	c->edited = true;
+	if (b->getLight())
+	{
+		c->setTorchLight(p.x, p.y, p.z, b->getLight());
+		this->lightEngine->lightBfsQueue.emplace(p.x, p.y, p.z, c);
+		this->lightEngine->lampLighting();
+	}
+	if (remesh)
+		this->updateBlock(pos);
+	return (true);
 }
\ No newline at end of file
@@ -1,67 +1,341 @@
 #include <engine.hpp>
 #include <textureEngine.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.hpp> // https://github.com/nothings/stb/blob/master/stb_image.h
 
+// cooked image, written next to the source the first time it's decoded: a header
+// and the whole mip chain as TextureImage lays it out. the hash of the source
+// bytes it came from makes an edited image decode again
+#define COOKED_IMAGE_MAGIC 0x31584554 // "TEX1"
+
+struct CookedImageHeader
+{
+	uint32_t magic;
+	int32_t width;
+	int32_t height;
+	int32_t components;
+	int32_t layers;
+	int32_t levels;
+	int32_t tiles;
+	uint32_t pad;
+	uint64_t hash;
+};
+
+// bytes of a mip chain starting at width x height
+static size_t chainSize(int width, int height, int layers, int components, int levels)
+{
+	size_t size = 0;
+	for (int i = 0; i < levels; i++, width = max(width / 2, 1), height = max(height / 2, 1))
+		size += (size_t)width * height * layers * components;
+	return (size);
+}
+
+// box filters every layer down to the next level, odd edges repeat their last texel
+static void downsample(const unsigned char *src, unsigned char *dst, int width, int height, int layers, int components)
+{
+	int w = max(width / 2, 1);
+	int h = max(height / 2, 1);
+	for (int l = 0; l < layers; l++, src += (size_t)width * height * components)
+		for (int y = 0; y < h; y++)
+		{
+			const unsigned char *row0 = src + (size_t)min(y * 2, height - 1) * width * components;
+			const unsigned char *row1 = src + (size_t)min(y * 2 + 1, height - 1) * width * components;
+			for (int x = 0; x < w; x++)
+			{
+				int x0 = min(x * 2, width - 1) * components;
+				int x1 = min(x * 2 + 1, width - 1) * components;
+				for (int c = 0; c < components; c++)
+					*dst++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+			}
+		}
+}
+
+// fnv-1a of the file, 0 when it can't be read
+static uint64_t hashFile(const string &path)
+{
+	struct stat st;
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return (0);
+	if (fstat(fd, &st) < 0 || st.st_size == 0)
+	{
+		close(fd);
+		return (0);
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (0);
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char *bytes = (const unsigned char *)map;
+	for (off_t i = 0; i < st.st_size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	munmap(map, st.st_size);
+	return (hash);
+}
+
+// levels of the whole mip chain for a width x height level 0
+static int chainLevels(int width, int height)
+{
+	int levels = 1;
+	while (max(width, height) >> levels)
+		levels++;
+	return (levels);
+}
+
+// a cooked image with a mip chain when one is asked for, with level 0 alone when not
+static bool mapCooked(const string &cooked, uint64_t hash, int tiles, bool mipmaps, TextureImage *image)
+{
+	struct stat st;
+	int fd = open(cooked.c_str(), O_RDONLY);
+	if (fd < 0)
+		return (false);
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(CookedImageHeader))
+	{
+		close(fd);
+		return (false);
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return (false);
+	const CookedImageHeader *header = (const CookedImageHeader *)map;
+	if (header->magic != COOKED_IMAGE_MAGIC || header->hash != hash || header->tiles != tiles
+		|| header->width <= 0 || header->height <= 0 || header->layers <= 0 || header->levels <= 0
+		|| header->components <= 0 || header->components > 4
+		|| header->levels != (mipmaps ? chainLevels(header->width, header->height) : 1)
+		|| sizeof(CookedImageHeader) + chainSize(header->width, header->height, header->layers, header->components, header->levels) != (size_t)st.st_size)
+	{
+		munmap(map, st.st_size);
+		return (false);
+	}
+	image->width = header->width;
+	image->height = header->height;
+	image->components = header->components;
+	image->layers = header->layers;
+	image->levels = header->levels;
+	image->pixels = (const unsigned char *)(header + 1);
+	image->map = map;
+	image->mapSize = st.st_size;
+	return (true);
+}
+
+// written to a temporary file first so a half written one is never mapped
+static void writeCooked(const string &cooked, uint64_t hash, int tiles, const TextureImage *image)
+{
+	CookedImageHeader header = {COOKED_IMAGE_MAGIC, image->width, image->height, image->components,
+		image->layers, image->levels, tiles, 0, hash};
+	string tmp = cooked + ".tmp";
+	ofstream out(tmp.c_str(), ios::binary);
+	out.write((const char *)&header, sizeof(header));
+	out.write((const char *)image->pixels, chainSize(image->width, image->height, image->layers, image->components, image->levels));
+	out.close();
+	if (!out || rename(tmp.c_str(), cooked.c_str()) < 0)
+		unlink(tmp.c_str());
+}
+
+TextureEngine::~TextureEngine()
+{
+	for (auto it = this->images.begin(); it != this->images.end(); it++)
+		this->release(it->second);
+}
+
+// maps the cooked image, or decodes the source (splitting an atlas into tiles * tiles
+// layers) and cooks it, with its mip chain unless it's never sampled with one. only
+// touches the image, safe on any thread
+TextureImage *TextureEngine::decode(const string &path, int tiles, bool mipmaps)
+{
+	TextureImage *image = new TextureImage();
+	string cooked = path + ".cooked";
+	uint64_t hash = this->cache ? hashFile(path) : 0;
+	if (hash && mapCooked(cooked, hash, tiles, mipmaps, image))
+		return (image);
+
+	int width, height, nrComponents;
+	unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, tiles ? 4 : 0);
+	if (!data)
+	{
+		delete image;
+		return (NULL);
+	}
+	image->components = tiles ? 4 : nrComponents;
+	image->layers = tiles ? tiles * tiles : 1;
+	image->width = tiles ? width / tiles : width;
+	image->height = tiles ? height / tiles : height;
+	// without the cache the driver builds the mipmaps like it always did
+	image->levels = this->cache && mipmaps ? chainLevels(image->width, image->height) : 1;
+	image->data.resize(chainSize(image->width, image->height, image->layers, image->components, image->levels));
+
+	unsigned char *dst = image->data.data();
+	if (tiles)
+	{
+		for (int row = 0; row < tiles; row++)
+			for (int col = 0; col < tiles; col++)
+				for (int y = 0; y < image->height; y++, dst += image->width * 4)
+					memcpy(dst, data + (((size_t)(row * image->height + y) * width + col * image->width) * 4), image->width * 4);
+	}
+	else
+		memcpy(dst, data, (size_t)width * height * image->components);
+	stbi_image_free(data);
+
+	dst = image->data.data();
+	for (int i = 1, w = image->width, h = image->height; i < image->levels; i++, w = max(w / 2, 1), h = max(h / 2, 1))
+	{
+		unsigned char *next = dst + (size_t)w * h * image->layers * image->components;
+		downsample(dst, next, w, h, image->layers, image->components);
+		dst = next;
+	}
+	image->pixels = image->data.data();
+	if (hash)
+		writeCooked(cooked, hash, tiles, image);
+	return (image);
+}
+
+// decodes every image not waiting for an upload yet on worker threads, the
+// load calls after it only copy them to the gpu
+void TextureEngine::preload(const vector<string> &paths, int tiles, bool mipmaps)
+{
+	vector<string> todo;
+	for (unsigned int i = 0; i < paths.size(); i++)
+		if (this->images.find(paths[i]) == this->images.end() && find(todo.begin(), todo.end(), paths[i]) == todo.end())
+			todo.push_back(paths[i]);
+	vector<TextureImage *> decoded(todo.size(), NULL);
+	atomic<size_t> next(0);
+	int count = min((int)todo.size(), max(1, (int)thread::hardware_concurrency()));
+	vector<thread> workers;
+	for (int i = 0; i < count; i++)
+		workers.emplace_back([&]() {
+			for (size_t j = next++; j < todo.size(); j = next++)
+				decoded[j] = this->decode(todo[j], tiles, mipmaps);
+		});
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	for (unsigned int i = 0; i < todo.size(); i++)
+		this->images[todo[i]] = decoded[i];
+}
+
+// the preloaded image if there is one for the same tiling, otherwise decoded now
+TextureImage *TextureEngine::take(const string &path, int tiles, bool mipmaps)
+{
+	auto it = this->images.find(path);
+	if (it != this->images.end())
+	{
+		TextureImage *image = it->second;
+		this->images.erase(it);
+		if (!image || image->layers == (tiles ? tiles * tiles : 1))
+			return (image);
+		this->release(image);
+	}
+	return (this->decode(path, tiles, mipmaps));
+}
+
+void TextureEngine::release(TextureImage *image)
+{
+	if (image && image->map)
+		munmap(image->map, image->mapSize);
+	delete image;
+}
+
+// uploads the image to the bound texture, with its mip chain or a generated one
+void TextureEngine::upload(GLenum target, TextureImage *image, bool mipmaps)
+{
+	GLenum format = GL_RGBA;
+	if (image->components == 1)
+		format = GL_RED;
+	else if (image->components == 2)
+		format = GL_RG;
+	else if (image->components == 3)
+		format = GL_RGB;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of the smaller levels aren't 4 byte aligned
+	const unsigned char *pixels = image->pixels;
+	int levels = mipmaps ? image->levels : 1;
+	for (int i = 0, w = image->width, h = image->height; i < levels; i++, w = max(w / 2, 1), h = max(h / 2, 1))
+	{
+		if (target == GL_TEXTURE_2D_ARRAY)
+			glTexImage3D(target, i, GL_RGBA8, w, h, image->layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		else
+			glTexImage2D(target, i, format, w, h, 0, format, GL_UNSIGNED_BYTE, pixels);
+		pixels += (size_t)w * h * image->layers * image->components;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	if (mipmaps && image->levels == 1)
+		glGenerateMipmap(target);
+}
 
 unsigned int TextureEngine::loadTexture(char const *path)
 {
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
+	TextureImage *image = this->take(path, 0);
+	if (image)
 	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		this->upload(GL_TEXTURE_2D, image, true);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-		stbi_image_free(data);
+		this->release(image);
 	}
 	else
-	{
 		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+	return textureID;
+}
+
+// splits a tiles x tiles atlas into the layers of a 2d texture array, so every
+// block texture gets its own mipmaps without bleeding into its neighbours
+unsigned int TextureEngine::loadTextureArray(char const *path, int tiles)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+
+	TextureImage *image = this->take(path, tiles);
+	if (image)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+		this->upload(GL_TEXTURE_2D_ARRAY, image, true);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		this->release(image);
 	}
+	else
+		std::cout << "Texture failed to load at path: " << path << std::endl;
 	return textureID;
 }
 
-// loads a cubemap texture from 6 individual texture faces
+// loads a cubemap texture from 6 individual texture faces, decoded side by side
 unsigned int TextureEngine::loadCubemap(vector<std::string> faces)
 {
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-	int width, height, nrChannels;
+	// sampled linearly without mipmaps, only level 0 is decoded and cooked
+	this->preload(faces, 0, false);
 	for (unsigned int i = 0; i < faces.size(); i++)
 	{
-		unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-		if (data)
+		TextureImage *image = this->take(faces[i], 0, false);
+		if (image)
 		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
+			this->upload(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, image, false);
+			this->release(image);
 		}
 		else
-		{
 			std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-		}
 	}
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -80,33 +354,20 @@ unsigned int TextureEngine::TextureFromFile(const char *path, const string &dire
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
+	TextureImage *image = this->take(filename, 0);
+	if (image)
 	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		this->upload(GL_TEXTURE_2D, image, true);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		stbi_image_free(data);
+		this->release(image);
 	}
 	else
-	{
 		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
 	return textureID;
 }
\ No newline at end of file